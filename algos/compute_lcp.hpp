@@ -0,0 +1,156 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  compute_lcp: library entry point computing the LCP of a (pruned) Wheeler graph
+ *               given in memory. The graph is passed as a wg::graph_view (L and the
+ *               packed out/in bitvectors) and the LCP values are written to a
+ *               caller buffer of lcp_size(g) entries, with INF (the maximum value
+ *               of uint_t) for the infinite entries. No file is read or written and
+ *               errors are returned in the status instead of exiting the process.
+ *
+ *      wg::graph_view g; g.L = L; g.L_length = ...; g.out = out; ...
+ *      std::vector<uint32_t> LCP;
+ *      wg::lcp_status st = wg::compute_lcp(g, wg::lcp_algorithm::beller, LCP);
+ *      if(not st.ok) std::cerr << st.error << std::endl;
+ *
+ *  If a sink is set in the options, it also receives the (position, LCP value)
+ *  entries as soon as they are final: level by level for the Beller and interval
+ *  stabbing algorithms, doubling step by doubling step for the doubling one
+ *  (see internal/lcp_stream.hpp).
+ */
+
+//============================================================================
+
+#ifndef ALGOS_COMPUTE_LCP_HPP_
+#define ALGOS_COMPUTE_LCP_HPP_
+
+#include <new>
+#include <memory>
+
+#include "internal/common.hpp"
+#include "internal/WG_string.hpp"
+#include "internal/interval_stabbing.hpp"
+#include "internal/doubling_ds.hpp"
+#include "internal/lcp_stream.hpp"
+#include "algos/interval_stabbing_algorithm.hpp"
+#include "algos/doubling_algorithm.hpp"
+
+namespace wg{
+
+/* LCP construction algorithms */
+enum class lcp_algorithm{
+	beller,             // generalization of the Beller et al. algorithm
+	interval_stabbing,  // interval stabbing algorithm
+	doubling            // generalization of the Manber-Myers doubling algorithm
+};
+
+/* options of compute_lcp */
+struct lcp_options{
+	// print the progress of the algorithm to stdout
+	bool verbose = false;
+	// if set, consumer of the final LCP entries, flushed at the end of each level
+	lcp_sink sink;
+	// maximum number of entries passed to a single sink call
+	uint64_t batch_size = (1 << 16);
+	// number of worker threads of the Beller and interval stabbing algorithms
+	unsigned threads = 1;
+	// batched forward steps in the single-threaded Beller algorithm
+	bool batched = false;
+	// queue levels sorted by left endpoint in the single-threaded algorithms
+	bool sorted = false;
+	// dense levels computed with a linear scan of L in the single-threaded algorithms
+	bool sweep = false;
+};
+
+/* result of compute_lcp, error is set when ok is false */
+struct lcp_status{
+	bool ok = true;
+	std::string error;
+};
+
+/* get the number of LCP entries of a graph_view, i.e. its number of nodes */
+inline uint64_t lcp_size(const graph_view& g){ return g.in_length - g.L_length; }
+
+/*
+ * Compute the LCP of the graph g with the given algorithm and write it to the
+ * buffer LCP of size entries, which must be at least lcp_size(g).
+ */
+template<class uint_t>
+lcp_status compute_lcp(const graph_view& g, lcp_algorithm algo, uint_t* LCP, uint64_t size,
+                       const lcp_options& opt = lcp_options())
+{
+	lcp_status st;
+	auto fail = [&](std::string error){ st.ok = false; st.error = error; return st; };
+	// build the container image, validating the input
+	wg_container wgc;
+	if(not wg_container::from_view(g, wgc, st.error)){ return fail(st.error); }
+	uint64_t n = wgc.get_no_nodes();
+	// INF and EMPTY must not be valid positions or LCP values
+	if(n >= uint64_t(std::numeric_limits<uint_t>::max()) - 2){ return fail("too many nodes for the index width"); }
+	if(LCP == nullptr or size < n){ return fail("the LCP buffer is smaller than the number of nodes"); }
+
+	try
+	{
+		std::unique_ptr<lcp_stream> stream;
+		if(opt.sink){ stream.reset(new lcp_stream(opt.sink, opt.batch_size)); }
+		typedef wg_fm_index<huff_wt, bit_vector, uint_t> fm_index_t;
+		if(algo == lcp_algorithm::doubling)
+		{
+			ds::doubling_ds<ds::static_rmq<uint_t>, bit_vector> ds(wgc, "");
+			wgc.clear();
+			prefix_doubling_fill_LCP(ds, opt.verbose, stream.get());
+			for(auto it = ds.begin_LCP(); it != ds.end_LCP(); ++it)
+				LCP[it.pos()] = *it;
+		}
+		else
+		{
+			// the interval stabbing algorithm does not use the wavelet tree
+			fm_index_t fm_index(wgc, "", algo == lcp_algorithm::beller);
+			std::fill(LCP, LCP+n, INF);
+			if(algo == lcp_algorithm::beller)
+			{
+				wgc.clear();
+				if(opt.threads > 1)
+					fill_LCP_Beller_gen_parallel(fm_index, LCP, opt.verbose, opt.threads, stream.get());
+				else if(opt.batched)
+					fill_LCP_Beller_gen_batched(fm_index, LCP, opt.verbose, stream.get(), opt.sorted, opt.sweep);
+				else
+					fill_LCP_Beller_gen(fm_index, LCP, opt.verbose, stream.get(), opt.sorted, opt.sweep);
+			}
+			else
+			{
+				interval_stabbing<fm_index_t> stab(wgc, &fm_index);
+				wgc.clear();
+				if(opt.threads > 1)
+					fill_LCP_interval_stabbing_parallel(stab, LCP, opt.verbose, opt.threads, stream.get());
+				else
+					fill_LCP_interval_stabbing(stab, LCP, opt.verbose, stream.get(), opt.sorted, opt.sweep);
+			}
+		}
+	}
+	catch(const std::bad_alloc&){ return fail("out of memory"); }
+	catch(const std::exception& e){ return fail(e.what()); }
+
+	return st;
+}
+
+/*
+ * Compute the LCP of the graph g with the given algorithm and store it in LCP,
+ * resized to lcp_size(g) entries.
+ */
+template<class uint_t>
+lcp_status compute_lcp(const graph_view& g, lcp_algorithm algo, std::vector<uint_t>& LCP,
+                       const lcp_options& opt = lcp_options())
+{
+	if(g.in_length < g.L_length){ lcp_status st; st.ok = false; st.error = "the L, in and out sequences are not consistent"; return st; }
+	try{ LCP.resize(lcp_size(g)); }
+	catch(const std::bad_alloc&){ lcp_status st; st.ok = false; st.error = "out of memory"; return st; }
+
+	return compute_lcp(g, algo, LCP.data(), LCP.size(), opt);
+}
+
+}
+
+#endif /* ALGOS_COMPUTE_LCP_HPP_ */
@@ -22,13 +22,27 @@
 
 #include "internal/common.hpp"
 #include "internal/static_rmq.hpp"
+#include "internal/lcp_stream.hpp"
 
+/* fill the LCP vector of ds, without any output. The entries filled by a doubling
+   step are final, so if stream is not null it receives them at the end of each step */
 template<class ds_t>
-void prefix_doubling_LCP(ds_t& ds,bool check_output,bool printLCP,bool verb)
+void prefix_doubling_fill_LCP(ds_t& ds,bool verb,wg::lcp_stream* stream = nullptr)
 {
+    // index width
+    typedef typename ds_t::uint_type uint_t;
+    // the bucket borders are set to 0 by the initialization
+    if(stream)
+    {
+        stream->push(0,0);
+        auto it = ds.begin_LCP();
+        for(++it; it != ds.end_LCP(); ++it)
+            if(*it == 0){ stream->push(it.pos(),0); }
+        stream->flush();
+    }
     // do first iteration for h = 1, then iternate until
     // we have finished all doubling steps.
-    uint not_filled_yet = ds.get_no_nodes() - ds.get_sigma() - 1;
+    uint_t not_filled_yet = ds.get_no_nodes() - ds.get_sigma() - 1;
     do{
         if(verb) std::cout << "======= doubling step: " << ds.get_h() << 
             " - LCP entries not yet filled: " << not_filled_yet << "\n";
@@ -42,7 +56,7 @@ void prefix_doubling_LCP(ds_t& ds,bool check_output,bool printLCP,bool verb)
             {
                 // compute the predecessors of the ith and (i-1)th nodes
                 // std::cout << it.pos() << " " << it.pos()-1 << "\n";
-                uint pred = ds.get_pred(it.pos()), predm1 = ds.get_pred(it.pos()-1);
+                uint_t pred = ds.get_pred(it.pos()), predm1 = ds.get_pred(it.pos()-1);
                 // skip this instance of the cycle if pred is not valid
                 if(pred == INF)
                 {
@@ -59,16 +73,30 @@ void prefix_doubling_LCP(ds_t& ds,bool check_output,bool printLCP,bool verb)
                         // prefix length h and the RMQ in LCP[pred(i-1)+1,pred(i)]
                         ds.update_LCP(it.pos(),ds.get_h() + 
                                                ds.rmq(predm1,pred) );
+                        if(stream) stream->push(it.pos(),*it);
                         not_filled_yet--;
                     } // end-if
                 } // end-else
             } // end-if
         } // end-for
+        // the doubling step is completed
+        if(stream) stream->flush();
     } // end-do 
     while ( (not_filled_yet > 0) && ds.doubling_step() ); // update ds data structure according to
-    // fix first LCP entry        // the next prefix length: h = h*2
+                                                          // the next prefix length: h = h*2
+    // entries still empty when no bucket changes have an infinite LCP
+    for(auto it = ds.begin_LCP(); it != ds.end_LCP(); ++it)
+        if(*it == EMPTY){ ds.update_LCP(it.pos(), INF); }
+    // fix first LCP entry
     ds.update_LCP(0,0);
     //ds.update_LCP(1,INF);
+}
+
+template<class ds_t>
+void prefix_doubling_LCP(ds_t& ds,bool check_output,bool printLCP,bool verb,bool compress = false)
+{
+    // compute the LCP values
+    prefix_doubling_fill_LCP(ds,verb);
     // print the LCP vector
     if( printLCP )
         ds.print_LCP();
@@ -76,7 +104,10 @@ void prefix_doubling_LCP(ds_t& ds,bool check_output,bool printLCP,bool verb)
     if( check_output )
         ds.check_output();
 
-    ds.to_file_LCP(ds.get_path()+".LCP");
+    if( compress )
+        ds.to_file_packed_LCP(ds.get_path()+".cLCP");
+    else
+        ds.to_file_LCP(ds.get_path()+".LCP");
 }
 
 #endif /* INTERNAL_DOUBLING_ALGO_HPP_ */
\ No newline at end of file
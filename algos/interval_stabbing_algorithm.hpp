@@ -16,33 +16,83 @@
 #include "internal/WG_string.hpp"
 #include "internal/hybrid_queue.hpp"
 #include "internal/check_output.hpp"
+#include "internal/spill_LCP.hpp"
+#include "internal/compact_LCP_vector.hpp"
+#include "internal/lcp_stream.hpp"
 
-/* Code implementing the generalization of the Beller et al. algorithm 
+#include <thread>
+#include <atomic>
+#include <exception>
+
+/* Code filling the LCP vector with the generalization of the Beller et al. algorithm
  * input: 
         wg: (wg_t) Wheeler graph FM-index data structure
-        check_output: (bool) flag saying if we need to check the result correctness    
-        printLCP: (bool) flag saying if we need to print the LCP vector
+        LCP: (lcp_t) a random-access LCP vector of wg.get_no_nodes() entries set to INF,
+             e.g. a std::vector<uint_t>, a wg::mmap_vector<uint_t> or a uint_t* buffer
         verb: (bool) flag saying if we need to activate the verbose mode
-    output:
-        LCP: (std::vector<uint_t>) a vector containing the LCP values
+        stream: (wg::lcp_stream*) if not null, receives the LCP entries of each level
+                as soon as the level is completed
+        sorted: (bool) flag saying if the levels of the queue are sorted by left endpoint
+        sweep: (bool) flag saying if the forward steps of the levels stored in the
+               bitvector regime of the queue are computed with a linear scan of L
 */
-template<class wg_t>
-std::vector<uint_t> compute_LCP_Beller_gen(wg_t& wg,bool check_output,bool printLCP, bool verb)
+template<class wg_t, class lcp_t>
+void fill_LCP_Beller_gen(wg_t& wg, lcp_t& LCP, bool verb, wg::lcp_stream* stream = nullptr, bool sorted = false,
+                         bool sweep = false)
 {
+    // index width
+    typedef typename wg_t::uint_type uint_t;
+    typedef std::pair<uint_t,uint_t> interval;
+    // maximum number of intervals of a chunk of a dense level
+    const uint64_t max_batch = (1 << 16);
     // initialize needed variables
     interval curr_int; 
-    // initialize LCP vector
-    std::vector<uint_t> LCP(wg.get_no_nodes(),INF);
+    // scratch buffers of the forward steps
+    typename wg_t::forward_buffer intervals;
+    // scratch buffers and scan state of the dense levels
+    std::vector<interval> batch;
+    typename wg_t::batch_buffer buf;
+    typename wg_t::sweep_state st;
     // initalize interval queue
-    wg::hybrid_queue<interval> queue(wg.get_no_nodes());
+    wg::hybrid_queue<interval,uint_t> queue(wg.get_no_nodes(),false,sorted);
     // fill next queue with first interval
     queue.push(0,wg.get_no_nodes());
+    // the first entry is fixed to 0
+    if(stream) stream->push(0,0);
 
     // scan intervals for next l value
     while(queue.set_queue_for_next_l())
     {
         if(verb) std::cout << "======== filling LCP values=" << queue.get_l() << 
             " - size of the queue= " << queue.get_size() << std::endl;
+        // the intervals of a dense level are popped by left endpoint: compute
+        // their forward steps in chunks with a single left to right scan of L
+        if(sweep and queue.bitvector_level())
+        {
+            wg.init_sweep(); st.reset();
+            while(not queue.empty())
+            {
+                // pop a chunk of intervals setting a new LCP value in LCP[l]
+                batch.clear();
+                while(not queue.empty() and batch.size() < max_batch)
+                {
+                    queue.pop_front(curr_int);
+                    if(LCP[curr_int.first] == INF)
+                    {
+                        LCP[curr_int.first] = queue.get_l()-1;
+                        if(stream and curr_int.first != 0) stream->push(curr_int.first, queue.get_l()-1);
+                        batch.push_back(curr_int);
+                    }
+                }
+                wg.forward_sweep(batch,buf,st);
+                // fill d+1 queue
+                for(uint64_t x=0;x<buf.cs.size();++x)
+                    if(LCP[buf.first[x]] == INF)
+                        queue.push(buf.first[x],buf.second[x]);
+            }
+            if(stream) stream->flush();
+            continue;
+        }
         // scan all intervals associated to the
         // current LCP value
         while(not queue.empty())
@@ -57,11 +107,11 @@ std::vector<uint_t> compute_LCP_Beller_gen(wg_t& wg,bool check_output,bool print
             { 
                 // set LCP entry
                 LCP[curr_int.first] = queue.get_l()-1;
+                if(stream and curr_int.first != 0) stream->push(curr_int.first, queue.get_l()-1);
                 // perform forward step
-                rank_pair intervals = 
-                wg.forward_all(curr_int.first,curr_int.second);
+                uint64_t k = wg.forward_all(curr_int.first,curr_int.second,intervals);
                 // fill d+1 queue
-                for(uint_t i=0;i<intervals.first.size();++i)
+                for(uint64_t i=0;i<k;++i)
                 {
                     //std::cout << "--> " << intervals.first[i] << " " << intervals.second[i] << "\n";
                     if(LCP[intervals.first[i]] != INF)
@@ -72,47 +122,397 @@ std::vector<uint_t> compute_LCP_Beller_gen(wg_t& wg,bool check_output,bool print
                 }
             } // end if
         } // end while
+        // the level is completed
+        if(stream) stream->flush();
+    } // end while
+    // fix first LCP entry
+    LCP[0] = 0;
+}
+
+/* Code filling the LCP vector with the generalization of the Beller et al. algorithm,
+ * computing the forward steps of the intervals of a level in batches: each batch is
+ * sorted and pushed through the wavelet tree one depth at a time (see
+ * wg_fm_index::forward_batch), so that the rank queries on the same node are grouped.
+ * input: 
+        wg: (wg_t) Wheeler graph FM-index data structure
+        LCP: (lcp_t) a random-access LCP vector of wg.get_no_nodes() entries set to INF
+        verb: (bool) flag saying if we need to activate the verbose mode
+        stream: (wg::lcp_stream*) if not null, receives the LCP entries of each level
+                as soon as the level is completed
+        sorted: (bool) flag saying if the levels of the queue are sorted by left endpoint
+        sweep: (bool) flag saying if the forward steps of the levels stored in the
+               bitvector regime of the queue are computed with a linear scan of L
+*/
+template<class wg_t, class lcp_t>
+void fill_LCP_Beller_gen_batched(wg_t& wg, lcp_t& LCP, bool verb, wg::lcp_stream* stream = nullptr, bool sorted = false,
+                                 bool sweep = false)
+{
+    // index width
+    typedef typename wg_t::uint_type uint_t;
+    typedef std::pair<uint_t,uint_t> interval;
+    // maximum number of intervals of a batch
+    const uint64_t max_batch = (1 << 20);
+    // initialize needed variables
+    interval curr_int; 
+    std::vector<interval> batch;
+    typename wg_t::batch_buffer buf;
+    typename wg_t::sweep_state st;
+    // initalize interval queue
+    wg::hybrid_queue<interval,uint_t> queue(wg.get_no_nodes(),false,sorted);
+    // fill next queue with first interval
+    queue.push(0,wg.get_no_nodes());
+    // the first entry is fixed to 0
+    if(stream) stream->push(0,0);
+
+    // scan intervals for next l value
+    while(queue.set_queue_for_next_l())
+    {
+        if(verb) std::cout << "======== filling LCP values=" << queue.get_l() << 
+            " - size of the queue= " << queue.get_size() << std::endl;
+        // the batches of a dense level are scanned in a single pass over L
+        bool dense = sweep and queue.bitvector_level();
+        if(dense){ wg.init_sweep(); st.reset(); }
+        while(not queue.empty())
+        {
+            // pop a batch of intervals setting a new LCP value in LCP[l]
+            batch.clear();
+            while(not queue.empty() and batch.size() < max_batch)
+            {
+                queue.pop_front(curr_int);
+                if(LCP[curr_int.first] == INF)
+                {
+                    LCP[curr_int.first] = queue.get_l()-1;
+                    if(stream and curr_int.first != 0) stream->push(curr_int.first, queue.get_l()-1);
+                    batch.push_back(curr_int);
+                }
+            }
+            // the rank queries follow the order of the intervals
+            if(not std::is_sorted(batch.begin(),batch.end()))
+                std::sort(batch.begin(),batch.end());
+            // perform the forward steps of the batch
+            if(dense)
+                wg.forward_sweep(batch,buf,st);
+            else
+                wg.forward_batch(batch,buf);
+            // fill d+1 queue
+            for(uint64_t x=0;x<buf.cs.size();++x)
+            {
+                if(LCP[buf.first[x]] != INF)
+                    continue;
+                // push new interval in the queue
+                queue.push(buf.first[x],buf.second[x]);
+            }
+        } // end while
+        // the level is completed
+        if(stream) stream->flush();
     } // end while
     // fix first LCP entry
     LCP[0] = 0;
+}
+
+/*
+ * run worker on the calling thread and on threads-1 new threads, which take their
+ * work from a shared counter; an exception thrown by a worker (e.g. bad_alloc) is
+ * rethrown by the calling thread once all threads have joined, and a thread that
+ * cannot be started leaves its work to the others
+ */
+template<class F>
+void run_workers(unsigned threads, F& worker)
+{
+    std::vector<std::exception_ptr> error(threads);
+    auto guarded = [&](unsigned t){ try{ worker(); } catch(...){ error[t] = std::current_exception(); } };
+    std::vector<std::thread> pool;
+    try{ for(unsigned t=1;t<threads;++t){ pool.push_back(std::thread(guarded,t)); } }
+    catch(...){}
+    guarded(0);
+    for(auto& t : pool){ t.join(); }
+    for(auto& e : error)
+        if(e) std::rethrow_exception(e);
+}
+
+/* Code filling the LCP vector with a level-synchronous parallel version of the
+ * generalization of the Beller et al. algorithm. The intervals of a level are popped
+ * from the hybrid queue in batches, and each batch is split in chunks processed by
+ * the worker threads, which claim the LCP entries with an atomic compare-and-swap and
+ * write the intervals of the next level in per-chunk buffers; the buffers are pushed
+ * back to the queue in chunk order, so the next level (and the LCP vector) does not
+ * depend on the thread scheduling. Only one batch is held in plain vectors, the
+ * levels keep the compressed and bitvector regimes of the queue.
+ * input: 
+        wg: (wg_t) Wheeler graph FM-index data structure, queried concurrently
+        LCP: (uint_t*) the wg.get_no_nodes() LCP entries, set to INF
+        verb: (bool) flag saying if we need to activate the verbose mode
+        threads: (unsigned) number of worker threads
+        stream: (wg::lcp_stream*) if not null, receives the LCP entries of each level
+                as soon as the level is completed
+*/
+template<class wg_t, class uint_t>
+void fill_LCP_Beller_gen_parallel(wg_t& wg, uint_t* LCP, bool verb, unsigned threads, wg::lcp_stream* stream = nullptr)
+{
+    typedef std::pair<uint_t,uint_t> interval;
+    // batches smaller than this are processed by the calling thread only
+    const uint64_t min_parallel = 4096;
+    // maximum number of intervals of a batch
+    const uint64_t max_batch = (1 << 20);
+    // intervals of the current batch and the per-chunk buffers of the next level
+    std::vector<interval> curr;
+    std::vector<std::vector<interval>> out;
+    std::vector<std::vector<uint_t>> claimed;
+    // initalize interval queue
+    wg::hybrid_queue<interval,uint_t> queue(wg.get_no_nodes());
+    // fill next queue with first interval
+    queue.push(0,wg.get_no_nodes());
+    // the first entry is fixed to 0
+    if(stream) stream->push(0,0);
+
+    // scan intervals for next l value
+    while(queue.set_queue_for_next_l())
+    {
+        if(verb) std::cout << "======== filling LCP values=" << queue.get_l() << 
+            " - size of the queue= " << queue.get_size() << std::endl;
+        // LCP value of the current level, INF for l = 0
+        const uint_t val = queue.get_l()-1;
+        while(not queue.empty())
+        {
+            // pop a batch of intervals of the current level
+            curr.resize(std::min<uint64_t>(queue.get_size(), max_batch));
+            for(auto& x : curr){ queue.pop_front(x); }
+            // split the batch in chunks
+            uint64_t chunk = std::max<uint64_t>(curr.size() / (8*uint64_t(threads)), 256);
+            uint64_t no_chunks = (curr.size() + chunk - 1) / chunk;
+            if(out.size() < no_chunks){ out.resize(no_chunks); }
+            if(stream and claimed.size() < no_chunks){ claimed.resize(no_chunks); }
+            std::atomic<uint64_t> next_chunk(0);
+            // process the chunks until none is left
+            auto worker = [&]()
+            {
+                // thread-local scratch buffers of the forward steps
+                typename wg_t::forward_buffer intervals;
+                for(uint64_t c; (c = next_chunk.fetch_add(1)) < no_chunks; )
+                {
+                    for(uint64_t k=c*chunk; k<std::min<uint64_t>((c+1)*chunk,curr.size()); ++k)
+                    {
+                        // claim the LCP entry of the left end
+                        uint_t expected = INF;
+                        if(not __atomic_compare_exchange_n(&LCP[curr[k].first], &expected, val, false,
+                                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                            continue;
+                        if(stream and curr[k].first != 0) claimed[c].push_back(curr[k].first);
+                        // perform forward step
+                        uint64_t no_int = wg.forward_all(curr[k].first,curr[k].second,intervals);
+                        for(uint64_t i=0;i<no_int;++i)
+                        {
+                            // skip entries set in the previous levels, the ones claimed
+                            // in this level are skipped in the next one
+                            uint_t x = __atomic_load_n(&LCP[intervals.first[i]], __ATOMIC_RELAXED);
+                            if(x != INF and x != val)
+                                continue;
+                            out[c].push_back(std::make_pair(uint_t(intervals.first[i]),uint_t(intervals.second[i])));
+                        }
+                    }
+                }
+            };
+            run_workers(threads > 1 and curr.size() >= min_parallel ? threads : 1, worker);
+            // push the next level in chunk order
+            for(uint64_t c=0;c<no_chunks;++c)
+            {
+                for(auto& x : out[c]){ queue.push(x.first,x.second); }
+                out[c].clear();
+                if(stream)
+                {
+                    for(auto x : claimed[c]){ stream->push(x, val); }
+                    claimed[c].clear();
+                }
+            }
+        }
+        // the level is completed
+        if(stream) stream->flush();
+    }
+    // fix first LCP entry
+    LCP[0] = 0;
+}
+
+/* Code implementing the generalization of the Beller et al. algorithm 
+ * input: 
+        wg: (wg_t) Wheeler graph FM-index data structure
+        check_output: (bool) flag saying if we need to check the result correctness    
+        printLCP: (bool) flag saying if we need to print the LCP vector
+        verb: (bool) flag saying if we need to activate the verbose mode
+        compress: (bool) flag saying if we need to write the LCP in the packed format (.cLCP)
+        threads: (unsigned) number of worker threads, the bit-packed LCP vectors
+                 are filled by a single thread
+        batched: (bool) flag saying if we need to compute the forward steps in batches
+        sorted: (bool) flag saying if the levels of the queue are sorted by left endpoint
+        sweep: (bool) flag saying if the dense levels are computed with a linear scan of L
+    output:
+        LCP: (lcp_t) a vector containing the LCP values, either a std::vector<uint_t>
+             or a wg::mmap_vector<uint_t> mapped on the .LCP output file
+*/
+template<class wg_t, class lcp_t = std::vector<typename wg_t::uint_type>>
+lcp_t compute_LCP_Beller_gen(wg_t& wg,bool check_output,bool printLCP, bool verb, bool compress = false,
+                             unsigned threads = 1, bool batched = false, bool sorted = false, bool sweep = false)
+{
+    // index width
+    typedef typename wg_t::uint_type uint_t;
+    // initialize LCP vector
+    lcp_t LCP; init_LCP(LCP,wg.get_path()+".LCP",wg.get_no_nodes(),INF);
+    // compute the LCP values
+    uint_t* data = LCP_data(LCP);
+    if(threads > 1 and data != nullptr)
+        fill_LCP_Beller_gen_parallel(wg,data,verb,threads);
+    else if(batched)
+        fill_LCP_Beller_gen_batched(wg,LCP,verb,nullptr,sorted,sweep);
+    else
+        fill_LCP_Beller_gen(wg,LCP,verb,nullptr,sorted,sweep);
     // check output
     if( check_output )
-        check_LCP_correctness<std::vector<uint_t>>(wg.get_path(),wg.get_no_nodes(),&LCP);
+        check_LCP_correctness<lcp_t>(wg.get_path(),wg.get_no_nodes(),&LCP);
     //print LCP
     if( printLCP )
         print_LCP(LCP);
 
-    write_LCP(wg.get_path()+".LCP", LCP);
+    if( compress )
+    {
+        wg::write_packed_LCP(wg.get_path()+".cLCP", LCP, LCP.size(), INF);
+        remove_LCP_file(wg.get_path()+".LCP", LCP);
+    }
+    else
+        store_LCP(wg.get_path()+".LCP", LCP);
 
     return LCP;
 }
 
-/* Code implementing the interval stabbing algorithm
+/* Code implementing the semi-external generalization of the Beller et al. algorithm.
+ * The LCP values are filled in increasing order, so the only random access needed
+ * is to know whether LCP[i] has been filled: we keep a bitvector of filled entries
+ * and spill the (position, value) records to disk, merging them at the end.
  * input: 
-        wg: (is_t) Interval stabbing data structure containing the Wheeler graph FM-index
+        wg: (wg_t) Wheeler graph FM-index data structure
         check_output: (bool) flag saying if we need to check the result correctness    
         printLCP: (bool) flag saying if we need to print the LCP vector
         verb: (bool) flag saying if we need to activate the verbose mode
+        compress: (bool) flag saying if we need to write the LCP in the packed format (.cLCP)
+        sorted: (bool) flag saying if the levels of the queue are sorted by left endpoint
     output:
-        LCP: (std::vector<uint_t>) a vector containing the LCP values
+        the LCP vector is written to the .LCP file
 */
-template<class is_t>
-std::vector<uint_t> compute_LCP_interval_stabbing(is_t& stab_ds,bool check_output,bool printLCP, bool verb)
+template<class wg_t>
+void compute_LCP_Beller_gen_semi_external(wg_t& wg,bool check_output,bool printLCP, bool verb, bool compress = false, bool sorted = false)
 {
+    // index width
+    typedef typename wg_t::uint_type uint_t;
+    typedef std::pair<uint_t,uint_t> interval;
+    // initialize needed variables
+    interval curr_int; uint_t n = wg.get_no_nodes();
+    // scratch buffers of the forward steps
+    typename wg_t::forward_buffer intervals;
+    // initialize bitvector of filled LCP entries
+    sdsl::bit_vector filled(n,0);
+    // initialize spill file, buffering about n bits of records
+    wg::spill_LCP<uint_t> spill(wg.get_path()+".LCP.spill", n, std::max<uint64_t>(n/(16*sizeof(uint_t)), 1 << 16));
+    // initalize interval queue
+    wg::hybrid_queue<interval,uint_t> queue(n,false,sorted);
+    // fill next queue with first interval
+    queue.push(0,n);
+
+    // scan intervals for next l value
+    while(queue.set_queue_for_next_l())
+    {
+        if(verb) std::cout << "======== filling LCP values=" << queue.get_l() << 
+            " - size of the queue= " << queue.get_size() << std::endl;
+        // scan all intervals associated to the
+        // current LCP value
+        while(not queue.empty())
+        {
+            // pop interval on the top of the queue
+            queue.pop_front(curr_int); 
+            // we propagate an [l,r] interval only if we 
+            // set a new LCP value in LCP[l] 
+            if(not filled[curr_int.first])
+            { 
+                // set LCP entry, the first entry is fixed at the end
+                filled[curr_int.first] = 1;
+                if(curr_int.first != 0)
+                    spill.push(curr_int.first, queue.get_l()-1);
+                // perform forward step
+                uint64_t k = wg.forward_all(curr_int.first,curr_int.second,intervals);
+                // fill d+1 queue
+                for(uint64_t i=0;i<k;++i)
+                {
+                    if(filled[intervals.first[i]])
+                        continue;
+
+                    // push new interval in the queue
+                    queue.push(intervals.first[i],intervals.second[i]);
+                }
+            } // end if
+        } // end while
+    } // end while
+    // fix first LCP entry
+    spill.push(0,0);
+    // merge the spilled runs in the LCP file
+    spill.merge(wg.get_path()+".LCP");
+    if(verb) std::cout << "merged " << spill.no_runs() << " sorted runs" << std::endl;
+
+    if( check_output or printLCP or compress )
+    {
+        wg::mmap_vector<uint_t> LCP(wg.get_path()+".LCP");
+        // check output
+        if( check_output )
+            check_LCP_correctness<wg::mmap_vector<uint_t>>(wg.get_path(),n,&LCP);
+        //print LCP
+        if( printLCP )
+            print_LCP(LCP);
+        if( compress )
+        {
+            wg::write_packed_LCP(wg.get_path()+".cLCP", LCP, LCP.size(), INF);
+            remove_LCP_file(wg.get_path()+".LCP", LCP);
+        }
+    }
+}
+
+/* Code filling the LCP vector with the interval stabbing algorithm
+ * input: 
+        stab_ds: (is_t) Interval stabbing data structure containing the Wheeler graph FM-index
+        LCP: (lcp_t) a random-access LCP vector of stab_ds.no_nodes() entries set to INF,
+             e.g. a std::vector<uint_t>, a wg::mmap_vector<uint_t> or a uint_t* buffer
+        verb: (bool) flag saying if we need to activate the verbose mode
+        stream: (wg::lcp_stream*) if not null, receives the LCP entries of each level
+                as soon as the level is completed
+        sorted: (bool) flag saying if the levels of the queue are sorted by left endpoint
+        sweep: (bool) flag saying if the forward steps of the levels stored in the
+               bitvector regime of the queue are computed with a linear scan of L
+*/
+template<class is_t, class lcp_t>
+void fill_LCP_interval_stabbing(is_t& stab_ds, lcp_t& LCP, bool verb, wg::lcp_stream* stream = nullptr, bool sorted = false,
+                                bool sweep = false)
+{
+    // index width
+    typedef typename is_t::uint_t uint_t;
+    // maximum number of bridges of a chunk of a dense level
+    const uint64_t max_batch = (1 << 16);
     // initialize needed variables
     uint_t curr_i; 
-    // initialize LCP vector
-    std::vector<uint_t> LCP(stab_ds.no_nodes(),INF);
+    // scratch buffer of the stabbing queries
+    std::vector<typename is_t::bridge> bridges;
+    // scratch buffers and scan state of the dense levels
+    std::vector<typename is_t::bridge> occs;
+    std::vector<uint_t> fwd;
+    typename is_t::sweep_state st;
     // initalize interval queue
-    wg::hybrid_queue<uint_t> queue(stab_ds.no_nodes(),true);
+    wg::hybrid_queue<uint_t,uint_t> queue(stab_ds.no_nodes(),true,sorted);
     // fill next queue with first interval
     std::vector<uint_t> first_entries = stab_ds.get_0_entries();
+    // the first entry is fixed to 0
+    if(stream) stream->push(0,0);
     for(uint_t i=0;i<first_entries.size();++i)
     {
         //std::cout << "inserisco: " << first_entries[i] << std::endl;
         queue.push(first_entries[i]);
         LCP[first_entries[i]] = 0;
+        if(stream and first_entries[i] != 0) stream->push(first_entries[i], 0);
     }
+    if(stream) stream->flush();
 
     // scan intervals for next l value
     while(queue.update_interval_stabbing_queue())
@@ -120,6 +520,36 @@ std::vector<uint_t> compute_LCP_interval_stabbing(is_t& stab_ds,bool check_outpu
         if(verb) std::cout << "======== filling LCP values=" << queue.get_l()+1 << 
                         " - size of the queue= " << queue.get_size() << std::endl;
         //if(queue.get_l()+1 == 5){ exit(1); }
+        // the values of a dense level are popped in increasing order: collect the
+        // bridges of a chunk and compute their forward steps with a scan of L
+        if(sweep and queue.bitvector_level())
+        {
+            stab_ds.reset_sweep(st);
+            while(not queue.empty())
+            {
+                occs.clear();
+                while(not queue.empty() and occs.size() < max_batch)
+                {
+                    queue.pop_front(curr_i);
+                    stab_ds.interval_stab_query(stab_ds.wfm_index->pos_to_node(curr_i),bridges);
+                    occs.insert(occs.end(),bridges.begin(),bridges.end());
+                }
+                // the bridges of a query can precede the ones of the previous query
+                auto by_pos = [](const typename is_t::bridge& a, const typename is_t::bridge& b){ return a.second < b.second; };
+                if(not std::is_sorted(occs.begin(),occs.end(),by_pos))
+                    std::sort(occs.begin(),occs.end(),by_pos);
+                stab_ds.forward_sweep(occs,fwd,st);
+                for(uint64_t i=0;i<fwd.size();++i)
+                {
+                    // set new LCP entry and push new value in the queue
+                    LCP[fwd[i]] = queue.get_l()+1;
+                    if(stream and fwd[i] != 0) stream->push(fwd[i], queue.get_l()+1);
+                    queue.push(fwd[i]);
+                }
+            }
+            if(stream) stream->flush();
+            continue;
+        }
         // scan all intervals associated to the current LCP value
         while(not queue.empty())
         {
@@ -127,33 +557,176 @@ std::vector<uint_t> compute_LCP_interval_stabbing(is_t& stab_ds,bool check_outpu
             queue.pop_front(curr_i); 
             //std::cout << "Processing: " << curr_i << " " << curr_i + 1 << std::endl;
             // compute stab query in the interval list
-            std::vector<bridge> bridges = 
-                 stab_ds.interval_stab_query(stab_ds.wfm_index->pos_to_node(curr_i));
+            stab_ds.interval_stab_query(stab_ds.wfm_index->pos_to_node(curr_i),bridges);
             // Process all stabbed bridges
-            for(uint_t i=0;i<bridges.size();++i)
+            for(uint64_t i=0;i<bridges.size();++i)
             {
                 //std::cout << char(bridges[i].first) << " " << bridges[i].second << std::endl;
-                uint_t i_p = stab_ds.wfm_index->forward(bridges[i].second,bridges[i].first);
+                uint_t i_p = stab_ds.forward(bridges[i].second,bridges[i].first);
                 // set new LCP entry
                 LCP[i_p] = queue.get_l()+1;
+                if(stream and i_p != 0) stream->push(i_p, queue.get_l()+1);
                 // std::cout << "insert--> " << i_p << "\n";
                 // push new value in the queue
                 queue.push(i_p);
             }
         }
+        // the level is completed
+        if(stream) stream->flush();
     }
     // fix first LCP entry
     LCP[0] = 0;
+}
+
+/* Code filling the LCP vector with a level-synchronous parallel version of the
+ * interval stabbing algorithm. The values of a level are popped from the queue in
+ * batches, and each batch is split in chunks processed by the worker threads, each
+ * with its own scratch buffers.
+ * The stabbed and border bits of the packed BWT are updated with atomic operations,
+ * so every interval is still stabbed by exactly one query, and the forward steps of
+ * a chunk are collected in a per-chunk buffer. The buffers are pushed in the queue
+ * in chunk order and the queue keeps each level sorted, so the level order (and the
+ * LCP vector) does not depend on the thread scheduling. Only one batch is held in
+ * plain vectors, the levels keep the compressed and bitvector regimes of the queue.
+ * input: 
+        stab_ds: (is_t) Interval stabbing data structure containing the Wheeler graph
+                 FM-index, queried concurrently
+        LCP: (uint_t*) the stab_ds.no_nodes() LCP entries, set to INF
+        verb: (bool) flag saying if we need to activate the verbose mode
+        threads: (unsigned) number of worker threads
+        stream: (wg::lcp_stream*) if not null, receives the LCP entries of each level
+                as soon as the level is completed
+*/
+template<class is_t, class uint_t>
+void fill_LCP_interval_stabbing_parallel(is_t& stab_ds, uint_t* LCP, bool verb, unsigned threads,
+                                         wg::lcp_stream* stream = nullptr)
+{
+    // batches smaller than this are processed by the calling thread only
+    const uint64_t min_parallel = 4096;
+    // maximum number of values of a batch
+    const uint64_t max_batch = (1 << 20);
+    // values of the current batch and the per-chunk buffers of the next level
+    std::vector<uint_t> curr;
+    std::vector<std::vector<uint_t>> out;
+    // initalize sorted interval queue
+    wg::hybrid_queue<uint_t,uint_t> queue(stab_ds.no_nodes(),true,true);
+    // fill next queue with first interval
+    std::vector<uint_t> first_entries = stab_ds.get_0_entries();
+    // the first entry is fixed to 0
+    if(stream) stream->push(0,0);
+    for(uint_t i=0;i<first_entries.size();++i)
+    {
+        queue.push(first_entries[i]);
+        LCP[first_entries[i]] = 0;
+        if(stream and first_entries[i] != 0) stream->push(first_entries[i], 0);
+    }
+    if(stream) stream->flush();
+
+    stab_ds.set_concurrent(true);
+    // scan intervals for next l value
+    while(queue.update_interval_stabbing_queue())
+    {
+        if(verb) std::cout << "======== filling LCP values=" << queue.get_l()+1 << 
+                        " - size of the queue= " << queue.get_size() << std::endl;
+        // LCP value of the current level
+        const uint_t val = queue.get_l()+1;
+        while(not queue.empty())
+        {
+            // pop a batch of values of the current level
+            curr.resize(std::min<uint64_t>(queue.get_size(), max_batch));
+            for(auto& x : curr){ queue.pop_front(x); }
+            // split the batch in chunks
+            uint64_t chunk = std::max<uint64_t>(curr.size() / (8*uint64_t(threads)), 256);
+            uint64_t no_chunks = (curr.size() + chunk - 1) / chunk;
+            if(out.size() < no_chunks){ out.resize(no_chunks); }
+            std::atomic<uint64_t> next_chunk(0);
+            // process the chunks until none is left
+            auto worker = [&]()
+            {
+                // thread-local scratch buffers of the stabbing queries
+                std::vector<typename is_t::bridge> bridges;
+                typename is_t::query_buffer qb;
+                for(uint64_t c; (c = next_chunk.fetch_add(1)) < no_chunks; )
+                {
+                    for(uint64_t k=c*chunk; k<std::min<uint64_t>((c+1)*chunk,curr.size()); ++k)
+                    {
+                        // compute stab query in the interval list
+                        stab_ds.interval_stab_query(stab_ds.wfm_index->pos_to_node(curr[k]),bridges,qb);
+                        // process all stabbed bridges, each forward step is a distinct entry
+                        for(uint64_t i=0;i<bridges.size();++i)
+                        {
+                            uint_t i_p = stab_ds.forward(bridges[i].second,bridges[i].first);
+                            LCP[i_p] = val;
+                            out[c].push_back(i_p);
+                        }
+                    }
+                }
+            };
+            run_workers(threads > 1 and curr.size() >= min_parallel ? threads : 1, worker);
+            // push the next level in chunk order
+            for(uint64_t c=0;c<no_chunks;++c)
+            {
+                for(auto x : out[c])
+                {
+                    queue.push(x);
+                    if(stream and x != 0) stream->push(x, val);
+                }
+                out[c].clear();
+            }
+        }
+        // the level is completed
+        if(stream) stream->flush();
+    }
+    stab_ds.set_concurrent(false);
+    // fix first LCP entry
+    LCP[0] = 0;
+}
+
+/* Code implementing the interval stabbing algorithm
+ * input: 
+        wg: (is_t) Interval stabbing data structure containing the Wheeler graph FM-index
+        check_output: (bool) flag saying if we need to check the result correctness    
+        printLCP: (bool) flag saying if we need to print the LCP vector
+        verb: (bool) flag saying if we need to activate the verbose mode
+        compress: (bool) flag saying if we need to write the LCP in the packed format (.cLCP)
+        sorted: (bool) flag saying if the levels of the queue are sorted by left endpoint
+        sweep: (bool) flag saying if the dense levels are computed with a linear scan of L
+        threads: (unsigned) number of worker threads, the bit-packed LCP vectors
+                 are filled by a single thread
+    output:
+        LCP: (lcp_t) a vector containing the LCP values, either a std::vector<uint_t>
+             or a wg::mmap_vector<uint_t> mapped on the .LCP output file
+*/
+template<class is_t, class lcp_t = std::vector<typename is_t::uint_t>>
+lcp_t compute_LCP_interval_stabbing(is_t& stab_ds,bool check_output,bool printLCP, bool verb, bool compress = false, bool sorted = false,
+                                     bool sweep = false, unsigned threads = 1)
+{
+    // index width
+    typedef typename is_t::uint_t uint_t;
+    // initialize LCP vector
+    lcp_t LCP; init_LCP(LCP,stab_ds.wfm_index->get_path()+".LCP",stab_ds.no_nodes(),INF);
+    // compute the LCP values
+    uint_t* data = LCP_data(LCP);
+    if(threads > 1 and data != nullptr)
+        fill_LCP_interval_stabbing_parallel(stab_ds,data,verb,threads);
+    else
+        fill_LCP_interval_stabbing(stab_ds,LCP,verb,nullptr,sorted,sweep);
     // print LCP
     if( printLCP )
         print_LCP(LCP);
     // check output
     if( check_output )
-        check_LCP_correctness<std::vector<uint_t>>(stab_ds.wfm_index->get_path(),
+        check_LCP_correctness<lcp_t>(stab_ds.wfm_index->get_path(),
                                                    stab_ds.wfm_index->get_no_nodes(),&LCP);
 
 
-    write_LCP(stab_ds.wfm_index->get_path()+".LCP", LCP);
+    if( compress )
+    {
+        wg::write_packed_LCP(stab_ds.wfm_index->get_path()+".cLCP", LCP, LCP.size(), INF);
+        remove_LCP_file(stab_ds.wfm_index->get_path()+".LCP", LCP);
+    }
+    else
+        store_LCP(stab_ds.wfm_index->get_path()+".LCP", LCP);
 
     return LCP;
 }
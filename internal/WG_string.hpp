@@ -10,115 +10,241 @@
 #define WG_STRING_HPP_
 
 #include "bit_vector.hpp"
+#include "select_rank_vector.hpp"
 #include "huff_wavelet_tree.hpp"
 
 namespace wg{
 
-template<class wt_t, class bit_vec_t>
+template<class wt_t, class bit_vec_t, class uint_t = ::uint_t>
 class wg_fm_index{
 
-private:
-	/* compute prefix sum */
-	void prefix_sum(std::vector<uint_t>& C)
-	{
-		for (uint_t i = 1; i < C.size(); i++)
-			C[i] = C[i - 1] + C[i];
-	}
-	/* initialize and compute C vector */
-	std::vector<uint_t> construct_C()
-	{
-		// initialize C vector
-		std::vector<uint_t> C(128,0);
-		// fill character frequencies
-		for(uint_t i=0;i<L.alph_size();++i)
-			C[L.at_char(i)] = L.at_freq(i);
-		// run prefix sum on C vector
-		prefix_sum(C);
-
-		return C;
-	}
-	/* check for the number of source edges */
-	uint_t check_source(std::string filepath)
-	{
-		uint_t no_sources = 0; uint_t bit = 49;
-		// open stream
-		std::ifstream bitstring(filepath);
-		// check first bites
-		while( bit == 49 ){
-			// read bit
-			bitstring.read(reinterpret_cast<char*>(&bit), sizeof(bool_t));
-			// increase no sources
-			no_sources++;
-		}
-		// check if every state has exactly one incoming edge
-		for(uint_t i=0;i<(L.size()-no_sources);++i)
-		{
-			bool_t flag = false;
-			if( bit == 49 ){ flag = true; }
-			// read bit
-			bitstring.read(reinterpret_cast<char*>(&bit), sizeof(bool_t));
-			if( bit == 48 ){ flag = true; }
-			// read bit
-			bitstring.read(reinterpret_cast<char*>(&bit), sizeof(bool_t));
-			// check flag
-			if( flag ){
-				std::cerr << "Error! all nodes must have exactly one incoming edge." 
-				                                                       << std::endl;
-				exit(1); }
-		}
-		// close stream
-		bitstring.close();
-		
-		return no_sources - 1;
-	}
-
 public:
+	// index width
+	typedef uint_t uint_type;
+
+	/* caller-owned scratch buffers of forward_all, reused across the calls */
+	struct forward_buffer{
+		// characters of the intervals
+		std::vector<char_wt> cs;
+		// left and right ends of the intervals
+		std::vector<uint_wt> first, second;
+	};
+	/* buffers of forward_batch, see wt_t::batch_buffer */
+	typedef typename wt_t::batch_buffer batch_buffer;
+	/* position of a left to right scan of L and occurrences of each character before it */
+	struct sweep_state{
+		uint64_t pos = 0;
+		uint_t cnt[256] = {0};
+		void reset(){ pos = 0; std::fill(cnt, cnt+256, uint_t(0)); }
+	};
+
 	// empty constructor
 	wg_fm_index(){}
 	/*
 	* Constructor that takes in input the basepath of the input files and construct
 	* an FM-index for the (pruned) Wheeler automaton with support to forward search.
 	*/
-	wg_fm_index(std::string basepath): path(basepath){
+	wg_fm_index(std::string basepath): wg_fm_index(wg_container::from_triple(basepath), basepath){}
+	/*
+	* Constructor that takes in input a container (mapped or ingested from the input
+	* files) and the basepath of the input files and construct the FM-index reading
+	* the container memory directly. If build_wt is false the wavelet tree of L is
+	* not built and only pos_to_node, forward_base and the size getters are supported,
+	* e.g. when the forward steps are computed by the interval stabbing data structure.
+	*/
+	wg_fm_index(const wg_container& wgc, std::string basepath, bool build_wt = true): path(basepath){
 		// construct the wavalet tree for the outgoinf labels
-		L = wt_t(basepath+".L");
+		if(build_wt){ L = wt_t(wgc.get_L(), wgc.get_L_length()); }
+		L_length = wgc.get_L_length();
 		// construct the bitvector encoding the out degrees
-		out = bit_vec_t(basepath+".out");
-		// compute the number of source nodes
-		has_source_incoming_edge = check_source(basepath+".in");
+		out = bit_vec_t(wgc.get_out(), wgc.get_out_length());
+		// number of source nodes, checked by the container
+		has_source_incoming_edge = wgc.get_sources();
 		// initialize C vector
-		C = construct_C();
+		C = std::vector<uint_t>(256,0);
+		for(uint_t c=0;c<255;++c)
+			C[c] = wgc.get_C(c+1);
+		C[255] = wgc.get_L_length();
+	}
+
+	/* serialize the FM-index to an output stream, the wavelet tree of L last */
+	void serialize(std::ostream& os) const
+	{
+		out.serialize(os);
+		uint_t sigma = C.size();
+		os.write(reinterpret_cast<const char*>(&sigma), sizeof(uint_t));
+		os.write(reinterpret_cast<const char*>(C.data()), sigma*sizeof(uint_t));
+		os.write(reinterpret_cast<const char*>(&has_source_incoming_edge), sizeof(uint_t));
+		os.write(reinterpret_cast<const char*>(&L_length), sizeof(uint_t));
+		L.serialize(os);
+	}
+
+	/* identifier of the serialization format of the out bitvector */
+	static uint64_t out_type_id(){ return bit_vec_t::type_id(); }
+
+	/*
+	* load an FM-index serialized with serialize(); if load_wt is false the wavelet
+	* tree of L is not read, as in the constructor with build_wt set to false
+	*/
+	void load(std::istream& is, std::string basepath, bool load_wt = true)
+	{
+		path = basepath;
+		out.load(is);
+		uint_t sigma;
+		is.read(reinterpret_cast<char*>(&sigma), sizeof(uint_t));
+		C.resize(sigma);
+		is.read(reinterpret_cast<char*>(C.data()), sigma*sizeof(uint_t));
+		is.read(reinterpret_cast<char*>(&has_source_incoming_edge), sizeof(uint_t));
+		is.read(reinterpret_cast<char*>(&L_length), sizeof(uint_t));
+		if(load_wt){ L.load(is); }
 	}
 
 	/* get number of edges */
-	uint_t get_L_length(){ return L.size(); }
+	uint_t get_L_length(){ return L_length; }
 	/* get number of states */
-	uint_t get_no_nodes(){ return L.size() + has_source_incoming_edge; }
+	uint_t get_no_nodes(){ return L_length + has_source_incoming_edge; }
 	/* get alphabet sigma */
 	uint_t get_sigma(){ return L.alphabet_size(); }
 	/* get path of the input file */
 	std::string get_path(){ return path; }
 
-	/* compute forward search step in the interval [i,j] */
-	rank_pair forward_all(uint_t i, uint_t j)
+	/*
+	* compute forward search step in the interval [i,j], writing the k resulting
+	* intervals in buf.first[0..k) and buf.second[0..k) without allocating once
+	* the buffers reached the alphabet size; returns k
+	*/
+	uint64_t forward_all(uint_t i, uint_t j, forward_buffer& buf)
 	{
 		// Find the interval in L
-		i = out.rank_0(out.select_1(i)); j = out.rank_0(out.select_1(j));
+		i = out.rank_0_select_1(i); j = out.rank_0_select_1(j);
 
 		// search intervals for all characters
-		rank_pair_char res =  L.search_intervals_in_range(i, j);
-		for(uint_t i=0;i<res.first.size();++i)
+		uint64_t k = L.search_intervals_in_range(i, j, buf.cs, buf.first, buf.second);
+		for(uint64_t x=0;x<k;++x)
 		{
 			// use C vector to map the intervals on F
-			res.second.first[i] += C[res.first[i]-1] + has_source_incoming_edge;
-			res.second.second[i] += C[res.first[i]-1] + has_source_incoming_edge;
+			buf.first[x] += C[buf.cs[x]-1] + has_source_incoming_edge;
+			buf.second[x] += C[buf.cs[x]-1] + has_source_incoming_edge;
 		}
 
-		return res.second;
+		return k;
+	}
+
+	/*
+	* compute the forward search step of all the intervals [i,j] in ints with a
+	* single batched traversal of the wavelet tree; the intervals reached from
+	* ints[k] are buf.first[x], buf.second[x] for x in [buf.offsets[k],buf.offsets[k+1])
+	*/
+	void forward_batch(const std::vector<std::pair<uint_t,uint_t>>& ints, batch_buffer& buf)
+	{
+		// Find the intervals in L
+		buf.ranges.resize(ints.size());
+		for(uint64_t k=0;k<ints.size();++k)
+			buf.ranges[k] = std::make_pair(out.rank_0_select_1(ints[k].first),
+			                               out.rank_0_select_1(ints[k].second));
+		// search intervals for all characters
+		L.search_intervals_in_range_batched(buf);
+		for(uint64_t x=0;x<buf.cs.size();++x)
+		{
+			// use C vector to map the intervals on F
+			buf.first[x] += C[buf.cs[x]-1] + has_source_incoming_edge;
+			buf.second[x] += C[buf.cs[x]-1] + has_source_incoming_edge;
+		}
+	}
+
+	/*
+	* build the plain copy of L read by the sweeps, one byte per label;
+	* it is built only once, at the first dense level
+	*/
+	void init_sweep()
+	{
+		if( L_plain.size() == L.size() ){ return; }
+		L_plain.resize(L.size());
+		for(uint64_t i=0;i<L.size();++i){ L_plain[i] = L[i]; }
+	}
+
+	/*
+	* compute the forward search step of all the intervals [i,j] in ints, sorted
+	* by left end, scanning L left to right from the position of the sweep state
+	* and counting the occurrences of each character instead of the rank queries;
+	* the results are stored as in forward_batch. An interval starting before the
+	* sweep position (e.g. overlapping the previous one) falls back to the wavelet
+	* tree. Requires init_sweep().
+	*/
+	void forward_sweep(const std::vector<std::pair<uint_t,uint_t>>& ints, batch_buffer& buf, sweep_state& st)
+	{
+		assert(L_plain.size() == L.size());
+		uint64_t m = ints.size();
+		buf.offsets.resize(m+1);
+		buf.cs.clear(); buf.first.clear(); buf.second.clear();
+		for(uint64_t k=0;k<m;++k)
+		{
+			buf.offsets[k] = buf.cs.size();
+			// Find the interval in L
+			uint64_t i = out.rank_0_select_1(ints[k].first), j = out.rank_0_select_1(ints[k].second);
+			if( i < st.pos )
+			{
+				uint64_t h = L.search_intervals_in_range(i, j, sweep_buf.cs, sweep_buf.first, sweep_buf.second);
+				buf.cs.insert(buf.cs.end(), sweep_buf.cs.begin(), sweep_buf.cs.begin()+h);
+				buf.first.insert(buf.first.end(), sweep_buf.first.begin(), sweep_buf.first.begin()+h);
+				buf.second.insert(buf.second.end(), sweep_buf.second.begin(), sweep_buf.second.begin()+h);
+				continue;
+			}
+			// count the characters preceding the interval
+			for(;st.pos<i;++st.pos){ st.cnt[L_plain[st.pos]]++; }
+			// the rank at i of a character is its count at its first occurrence
+			uint64_t seen[4] = {0,0,0,0}, start = buf.cs.size();
+			for(;st.pos<j;++st.pos)
+			{
+				char_t c = L_plain[st.pos];
+				if( !(seen[c >> 6] & (uint64_t(1) << (c & 63))) )
+				{
+					seen[c >> 6] |= uint64_t(1) << (c & 63);
+					buf.cs.push_back(c); buf.first.push_back(st.cnt[c]);
+				}
+				st.cnt[c]++;
+			}
+			for(uint64_t x=start;x<buf.cs.size();++x){ buf.second.push_back(st.cnt[buf.cs[x]]); }
+		}
+		buf.offsets[m] = buf.cs.size();
+		for(uint64_t x=0;x<buf.cs.size();++x)
+		{
+			// use C vector to map the intervals on F
+			buf.first[x] += C[buf.cs[x]-1] + has_source_incoming_edge;
+			buf.second[x] += C[buf.cs[x]-1] + has_source_incoming_edge;
+		}
+	}
+
+	/*
+	* compute the forward search step of all the (character, position) pairs in
+	* occs, sorted by position, scanning L left to right from the position of the
+	* sweep state; res[x] is forward(occs[x].second, occs[x].first). A position
+	* before the sweep position falls back to the wavelet tree. Requires init_sweep().
+	*/
+	void forward_sweep(const std::vector<std::pair<char_t,uint_t>>& occs, std::vector<uint_t>& res, sweep_state& st)
+	{
+		assert(L_plain.size() == L.size());
+		res.resize(occs.size());
+		for(uint64_t x=0;x<occs.size();++x)
+		{
+			if( occs[x].second < st.pos ){ res[x] = forward(occs[x].second, occs[x].first); continue; }
+			for(;st.pos<occs[x].second;++st.pos){ st.cnt[L_plain[st.pos]]++; }
+			res[x] = st.cnt[occs[x].first] + C[occs[x].first-1] + has_source_incoming_edge;
+		}
+	}
+
+	/* compute forward search step in the interval [i,j] */
+	rank_pair forward_all(uint_t i, uint_t j)
+	{
+		forward_buffer buf;
+		uint64_t k = forward_all(i, j, buf);
+		buf.first.resize(k); buf.second.resize(k);
+
+		return std::make_pair(std::move(buf.first),std::move(buf.second));
 	}
 
 	/* compute mapping between a position in the BWT and a node in the input */
-	uint_t pos_to_node(uint_t i){ return out.rank_0(out.select_1(i)); }
+	uint_t pos_to_node(uint_t i){ return out.rank_0_select_1(i); }
 
 	/* compute forward search step for position j */
 	uint_t forward(uint_t j, char_t c)
@@ -133,6 +259,10 @@ public:
 		return rank_res;
 	}
 
+	/* first position reached by a forward step with label c, i.e. forward(j,c)
+	   for the first occurrence j of c in L */
+	uint_t forward_base(char_t c){ return C[c-1] + has_source_incoming_edge; }
+
 	/* wrapper to select query on the wavelet tree */
 	uint_t select_wt(uint_t i, char_t c){ return L.select(i,c); }
 	/* wrapper to select query on the wavelet tree */
@@ -166,8 +296,13 @@ private:
 	bit_vec_t out;
 	// number of source states
 	uint_t has_source_incoming_edge;
+	// length of L
+	uint_t L_length = 0;
 	// input file path
 	std::string path;
+	// plain copy of L and scratch buffer of the sweeps
+	std::vector<char_t> L_plain;
+	forward_buffer sweep_buf;
 };
 
 }
@@ -27,7 +27,7 @@ public:
 	/*
 	 * constructor that builds a bitvector given its size
 	 */
-	bit_vector(uint_t u_): u(u_){
+	bit_vector(uint64_t u_): u(u_){
 		// init u size bitvector 
 		bv = sdsl::bit_vector(u,0);
 	}
@@ -40,7 +40,7 @@ public:
 		std::ifstream bitstring(filepath);
 		// compute bitvector length
 		bitstring.seekg(0, std::ios::end);
-		uint_t size = bitstring.tellg();
+		uint64_t size = bitstring.tellg();
     	bitstring.seekg(0, std::ios::beg);
 
 		if(size==0)
@@ -53,7 +53,7 @@ public:
 		u = size; char_t curr_bit;
 		bv = sdsl::bit_vector(u,0);
 		// iterate over all bits in the input
-		for(uint_t i=0;i<size;++i){
+		for(uint64_t i=0;i<size;++i){
 			// get new bit
 			bitstring.read(reinterpret_cast<char*>(&curr_bit), sizeof(char));
 			if(curr_bit == '1')
@@ -67,12 +67,48 @@ public:
 		select1 = sdsl::bit_vector::select_1_type(&bv);
 	}
 
+	/*
+	 * constructor that builds a bitvector by copying u bits packed in 64-bit words
+	 */
+	bit_vector(const uint64_t* words, uint64_t u_): u(u_){
+		if(u==0)
+		{
+			std::cerr << "Error! empty bitvector, exiting...\n";
+			exit(1);
+		}
+		// initialize and fill bitvector
+		bv = sdsl::bit_vector(u,0);
+		std::memcpy(bv.data(), words, ((u+63)/64)*sizeof(uint64_t));
+		// rank and select support
+		rank0 = sdsl::bit_vector::rank_0_type(&bv);
+		select1 = sdsl::bit_vector::select_1_type(&bv);
+	}
+
+	/*
+	 * serialize the bitvector and its rank/select support to an output stream
+	 */
+	void serialize(std::ostream& out) const {
+		out.write(reinterpret_cast<const char*>(&u), sizeof(u));
+		bv.serialize(out); rank0.serialize(out); select1.serialize(out);
+	}
+
+	/*
+	 * load a bitvector serialized with serialize()
+	 */
+	void load(std::istream& in){
+		in.read(reinterpret_cast<char*>(&u), sizeof(u));
+		bv.load(in); rank0.load(in,&bv); select1.load(in,&bv);
+	}
+
+	/* identifier of the serialization format */
+	static uint64_t type_id(){ return 1; }
+
 	/*
 	*  get the size of the bitvector
 	*/
-	uint_t size(){return u;}
+	uint64_t size(){return u;}
 	
-	bool operator[](uint_t i){
+	bool operator[](uint64_t i){
 		// check index size
 		assert(i<u);
 		
@@ -89,7 +125,7 @@ public:
 	    return *this;
 	}
 
-	void set_bit(uint_t i)  
+	void set_bit(uint64_t i)  
 	{ 
 		// check index size
 		assert(i<u);
@@ -97,7 +133,7 @@ public:
 		bv[i] = 1;
 	}
 
-	void unset_bit(uint_t i)
+	void unset_bit(uint64_t i)
 	{
 		// check index size  
 		assert(i<u);
@@ -105,7 +141,7 @@ public:
 		bv[i] = 0;
 	}
 
-	uint_t rank_0(uint_t i)
+	uint64_t rank_0(uint64_t i)
 	{
 		// check index size
 		assert(i<u);
@@ -113,7 +149,7 @@ public:
 		return rank0(i);
 	}
 
-	uint_t rank_1(uint_t i)
+	uint64_t rank_1(uint64_t i)
 	{
 		// check index size
 		assert(i<u+1);
@@ -121,7 +157,7 @@ public:
 		return rank1(i);
 	}
 
-	uint_t select_1(uint_t i)
+	uint64_t select_1(uint64_t i)
 	{
 		// check index size
 		assert(i<=u);
@@ -132,6 +168,21 @@ public:
 		return select1(i);
 	}
 
+	/*
+	 * number of zeros preceding the ith one, i.e. rank_0(select_1(i)), with a
+	 * single select: the ith one is preceded by i-1 ones
+	 */
+	uint64_t rank_0_select_1(uint64_t i)
+	{
+		// check index size
+		assert(i<=u);
+
+		if( i==0 )
+			return 0;
+
+		return select1(i) - (i-1);
+	}
+
 	void init_rank_1_support()
 	{
 		// compute rank 1 support ds
@@ -141,7 +192,7 @@ public:
 private:
 
 	//bitvector length
-	uint_t u = 0;
+	uint64_t u = 0;
 	// bitvector + rank/select support
 	sdsl::bit_vector bv;
 	sdsl::bit_vector::rank_0_type rank0;
@@ -18,6 +18,9 @@ template<typename LCP_type>
 class check_LCP_correctness{
 
 private:
+	// index width
+	typedef typename LCP_type::value_type uint_t;
+
 	/* parse an edge line */
 	void tokenize(std::string const &str, const char delim, 
 	            std::vector<std::string> &out) 
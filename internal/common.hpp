@@ -16,6 +16,8 @@
 #include <cassert>
 #include <queue>
 #include <algorithm>
+#include <limits>
+#include <type_traits>
 
 #include <math.h>
 #include <stdio.h>
@@ -27,25 +29,32 @@
 #include <sdsl/int_vector.hpp>
 #include <sdsl/util.hpp>
 
+#include "wg_container.hpp"
+#include "packed_LCP.hpp"
+#include "mmap_vector.hpp"
+
 #ifndef M64
 	#define M64 0
 #endif
 
+/*
+ * Default index width. The data structures and the algorithms take the index
+ * width as a template parameter named uint_t (defaulting to this type), which
+ * hides the global typedef in their scope; compute-LCP selects it at runtime
+ * from the number of nodes.
+ */
 #if M64
     typedef uint64_t uint_t;
-    typedef uint8_t char_t;
-    typedef bool bool_t;
-    typedef sdsl::int_vector<64> int_vector;
-    #define INF UINT64_MAX
-    #define EMPTY UINT64_MAX - 1
 #else
     typedef uint32_t uint_t;
-    typedef uint8_t char_t;
-    typedef bool bool_t;
-    typedef sdsl::int_vector<32> int_vector;
-    #define INF UINT32_MAX
-    #define EMPTY UINT32_MAX - 1
 #endif
+typedef uint8_t char_t;
+typedef bool bool_t;
+typedef sdsl::int_vector<sizeof(uint_t)*8> int_vector;
+
+// infinite and empty LCP values of the index width uint_t in scope
+#define INF (std::numeric_limits<uint_t>::max())
+#define EMPTY (std::numeric_limits<uint_t>::max() - 1)
 
 typedef sdsl::wt_huff<>::value_type char_wt;
 typedef sdsl::wt_huff<>::size_type uint_wt;
@@ -53,10 +62,12 @@ typedef std::pair<std::vector<uint_wt>,std::vector<uint_wt>> rank_pair;
 typedef std::pair<std::vector<char_wt>,rank_pair> rank_pair_char;
 
 /* function printing the LCP vector */
-void print_LCP(const std::vector<uint_t>& LCP)
+template<class vec_t>
+void print_LCP(const vec_t& LCP)
 {
+    typedef typename vec_t::value_type uint_t;
     std::cout << "LCP =====\n";
-    for(uint_t i=0;i<LCP.size();++i)
+    for(uint64_t i=0;i<LCP.size();++i)
     {
         std::cout << i << " : ";
         if( LCP[i] == INF )
@@ -66,12 +77,75 @@ void print_LCP(const std::vector<uint_t>& LCP)
     }
 }
 
+/* initialize a LCP vector of n entries set to val, file-backed vectors are mapped on ofile_path */
+template<class uint_t>
+void init_LCP(std::vector<uint_t>& LCP, const std::string /*ofile_path*/, uint64_t n, uint64_t val)
+{
+    LCP.assign(n,val);
+}
+template<uint8_t t_width>
+void init_LCP(sdsl::int_vector<t_width>& LCP, const std::string /*ofile_path*/, uint64_t n, uint64_t val)
+{
+    LCP = sdsl::int_vector<t_width>(n,val);
+}
+template<class uint_t>
+void init_LCP(wg::mmap_vector<uint_t>& LCP, const std::string ofile_path, uint64_t n, uint64_t val)
+{
+    LCP.open(ofile_path,n,val);
+}
+
+/* tell if the entries of a LCP vector are stored in its output file during the construction */
+template<class vec_t>
+struct is_file_backed : std::false_type{};
+template<class uint_t>
+struct is_file_backed<wg::mmap_vector<uint_t>> : std::true_type{};
+
+/* get a pointer to the entries of a LCP vector of plain integers, nullptr for bit-packed vectors */
+template<class uint_t>
+uint_t* LCP_data(std::vector<uint_t>& LCP){ return LCP.data(); }
+template<class uint_t>
+uint_t* LCP_data(wg::mmap_vector<uint_t>& LCP){ return LCP.data(); }
+
 /* print vector to file */
+template<class uint_t>
 void write_LCP(const std::string ofile_path, const std::vector<uint_t>& LCP)
 {
     FILE * ofile = std::fopen(ofile_path.c_str(), "w");
     fwrite(&LCP[0], sizeof(uint_t), LCP.size(), ofile);
     fclose(ofile);
 }
+template<uint8_t t_width>
+void write_LCP(const std::string ofile_path, const sdsl::int_vector<t_width>& LCP)
+{
+    FILE * ofile = std::fopen(ofile_path.c_str(), "w");
+    fwrite(LCP.data(), LCP.width()/8, LCP.size(), ofile);
+    fclose(ofile);
+}
+// defined in compact_LCP_vector.hpp
+namespace wg{ template<class uint_t> class compact_LCP_vector; }
+template<class uint_t>
+void write_LCP(const std::string ofile_path, const wg::compact_LCP_vector<uint_t>& LCP);
+
+/*
+ * print a LCP vector of any kind to file: file-backed vectors are skipped, their
+ * mapped file being the output already (overloads chosen by is_file_backed)
+ */
+template<class vec_t>
+void store_LCP(const std::string ofile_path, const vec_t& LCP, std::false_type){ write_LCP(ofile_path, LCP); }
+template<class vec_t>
+void store_LCP(const std::string /*ofile_path*/, const vec_t& /*LCP*/, std::true_type){}
+template<class vec_t>
+void store_LCP(const std::string ofile_path, const vec_t& LCP)
+{
+    store_LCP(ofile_path, LCP, is_file_backed<vec_t>());
+}
+
+/* remove the file a file-backed LCP vector is mapped on, when the LCP is output in another format */
+template<class vec_t>
+void remove_LCP_file(const std::string ofile_path, const vec_t& /*LCP*/)
+{
+    if( is_file_backed<vec_t>::value )
+        std::remove(ofile_path.c_str());
+}
 
 #endif /* INTERNAL_COMMON_HPP_ */
\ No newline at end of file
@@ -0,0 +1,117 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * compact_LCP_vector: LCP vector bit-packed in an sdsl int_vector with the minimum
+ *                     width w such that all values in [0,n] fit below the two
+ *                     escape codes 2^w-2 (EMPTY) and 2^w-1 (INF); e.g. 40 bits
+ *                     for graphs with up to 2^40-3 nodes
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_COMPACT_LCP_VECTOR_HPP_
+#define INTERNAL_COMPACT_LCP_VECTOR_HPP_
+
+#include "common.hpp"
+
+namespace wg{
+
+template<class uint_t = ::uint_t>
+class compact_LCP_vector{
+
+private:
+	/* map INF and EMPTY to the escape codes */
+	uint64_t encode(uint_t x) const
+	{
+		if(x == INF){ return mask; }
+		if(x == EMPTY){ return mask-1; }
+		return x;
+	}
+	/* map the escape codes to INF and EMPTY */
+	uint_t decode(uint64_t x) const
+	{
+		if(x == mask){ return INF; }
+		if(x == mask-1){ return EMPTY; }
+		return x;
+	}
+
+public:
+	// types of the entries, of their read-only references and of the sizes
+	typedef uint_t value_type;
+	typedef uint_t const_reference;
+	typedef uint64_t size_type;
+
+	/* reference to an entry, encoding the assigned values */
+	class reference{
+	public:
+		reference(compact_LCP_vector* v_, uint64_t i_): v(v_), i(i_) {}
+		operator uint_t() const { return v->decode(v->LCP[i]); }
+		reference& operator=(uint_t x){ v->LCP[i] = v->encode(x); return *this; }
+		reference& operator=(const reference& r){ return *this = uint_t(r); }
+	private:
+		compact_LCP_vector* v;
+		uint64_t i;
+	};
+
+	// empty constructor
+	compact_LCP_vector(){}
+	/*
+	* Constructor that initializes a vector of n entries set to val, able to
+	* store values up to n
+	*/
+	compact_LCP_vector(uint64_t n, uint_t val)
+	{
+		// compute the width
+		uint8_t w = 2;
+		while(w < 64 and (uint64_t(1) << w) - 2 <= n){ w++; }
+		mask = (w == 64) ? UINT64_MAX : (uint64_t(1) << w) - 1;
+		LCP = sdsl::int_vector<0>(n, encode(val), w);
+	}
+
+	/* get number of entries */
+	uint64_t size() const { return LCP.size(); }
+	/* get width in bits of the entries */
+	uint8_t width() const { return LCP.width(); }
+
+	/* access ith entry */
+	uint_t operator[](uint64_t i) const { return decode(LCP[i]); }
+	reference operator[](uint64_t i){ return reference(this, i); }
+
+private:
+	// bit-packed entries
+	sdsl::int_vector<0> LCP;
+	// escape code of INF
+	uint64_t mask = 0;
+};
+
+}
+
+/* initialize a compact LCP vector of n entries set to val */
+template<class uint_t>
+void init_LCP(wg::compact_LCP_vector<uint_t>& LCP, const std::string /*ofile_path*/, uint64_t n, uint64_t val)
+{
+    LCP = wg::compact_LCP_vector<uint_t>(n,val);
+}
+
+/* the entries of a compact LCP vector are bit-packed */
+template<class uint_t>
+uint_t* LCP_data(wg::compact_LCP_vector<uint_t>& /*LCP*/){ return nullptr; }
+
+/* print compact LCP vector to file, with entries of the index width */
+template<class uint_t>
+void write_LCP(const std::string ofile_path, const wg::compact_LCP_vector<uint_t>& LCP)
+{
+    FILE * ofile = std::fopen(ofile_path.c_str(), "w");
+    std::vector<uint_t> buf; buf.reserve(1 << 16);
+    for(uint64_t i=0;i<LCP.size();++i)
+    {
+        buf.push_back(LCP[i]);
+        if(buf.size() == buf.capacity()){ fwrite(buf.data(), sizeof(uint_t), buf.size(), ofile); buf.clear(); }
+    }
+    fwrite(buf.data(), sizeof(uint_t), buf.size(), ofile);
+    fclose(ofile);
+}
+
+#endif /* INTERNAL_COMPACT_LCP_VECTOR_HPP_ */
@@ -22,51 +22,14 @@ namespace ds{
 template<class rmq_t, class bit_vec_t>
 class doubling_ds{
 
+public:
+	// index width
+	typedef typename rmq_t::uint_type uint_t;
+	typedef uint_t uint_type;
+
 private:
 	// character frequency
 	std::vector<uint_t> freq;
-	/* compute character frequencies */
-	void compute_character_frequencies(std::string filepath, uint_t& size
-	                                   , std::vector<uint_t>& freq)
-	{
-		// resize frequency vector
-		freq = std::vector<uint_t>(128,0);
-		// open L vector stream
-		std::ifstream Lstring(filepath); char_t c;
-		// read vector len
-		Lstring.seekg(0, std::ios::end);
-		size = Lstring.tellg();
-    	Lstring.seekg(0, std::ios::beg);
-    	// scan file
-		for(uint_t i=0;i<size;++i){
-			// read bit
-			Lstring.read(reinterpret_cast<char*>(&c), sizeof(char_t));
-			// increase character frequency
-			freq[c]++;
-		}
-		// close stream
-		Lstring.close();
-	}
-
-	/* check for the number of source edges */
-	uint_t check_source(std::string filepath)
-	{
-		uint_t no_sources = 0; char_t bit = '1';
-		// open stream
-		std::ifstream bitstring(filepath);
-		// check first bites
-		while( bit == '1' ){
-			// read bit
-			bitstring.read(reinterpret_cast<char*>(&bit), sizeof(char_t));
-			// increase no sources
-			no_sources++;
-		}
-		// close stream
-		bitstring.close();
-		
-		return no_sources - 1;
-	}
-
 	/* init bucket ids */
 	void init_bucket_ids()
 	{
@@ -96,44 +59,31 @@ private:
 		H.update_rmq_support();
 	}
 
-	/* function to initialize the predecessor vector by reading .L and .out files */
-	void init_predecessor_vector(std::string filepath,
-								 std::string filepath2)
+	/* function to initialize the predecessor vector from the packed out bitvector and L */
+	void init_predecessor_vector(const uint64_t* out, const uint8_t* L)
 	{
 		// resize predecessor vector
 		M.resize(n);
-		// open streams
-		std::ifstream bitstring(filepath);
-		std::ifstream Lstring(filepath2);
 		// init variables
-		char_t bit = '0', c; uint_t run = 0, id = 0;
+		uint_t run = 0, id = 0, l = 0;
 		// set first entries
 		for(uint_t i=0;i<sources;++i)
 			M[i] = INF;
-		// iterate over .out file
+		// iterate over the out bitvector
 		for(uint_t i=0;i<(2*n)-sources;++i)
 		{
-			// read bit
-			bitstring.read(reinterpret_cast<char*>(&bit), sizeof(char_t));
-			//std::cout << bit << "";
 			// extend a run of zeroes otherwise insert a new predecessor
-			if(bit == '0')
+			if(((out[i/64] >> (i%64)) & 1) == 0)
 				run++;
 			else
 			{
 				for(uint_t j=0;j<run;++j)
-				{
-					Lstring.read(reinterpret_cast<char*>(&c), sizeof(char_t));
-					//std::cout << c << "\n";
 					// set a new entry in M vector
-					M[freq[c]++] = id;
-				}
+					M[freq[L[l++]]++] = id;
 				// start with a new zero run
 				run = 0; id++;
 			}
 		}
-		// close streams
-		bitstring.close(); Lstring.close();
 	}
 
     /* update predecessor vector for the next h*2 iteration */
@@ -187,19 +137,28 @@ public:
 	* Constructor that takes in input the basepath of the input files and construct
 	* all data structures needed for running prefix doubling algorithm.
 	*/
-	doubling_ds(std::string basepath): path(basepath){
-		// compute character frequencies
-		compute_character_frequencies(basepath+".L",n,freq);
-		// compute number of sources
-		sources = check_source(basepath+".in"); n += sources;
+	doubling_ds(std::string basepath): doubling_ds(wg::wg_container::from_triple(basepath), basepath){}
+
+	/*
+	* Constructor that takes in input a container (mapped or ingested from the input
+	* files) and the basepath of the input files and construct all data structures
+	* needed for running prefix doubling.
+	*/
+	doubling_ds(const wg::wg_container& wgc, std::string basepath): path(basepath){
+		// character frequencies from the container C array
+		freq = std::vector<uint_t>(256,0);
+		for(uint_t c=0;c<256;++c)
+			freq[c] = ((c < 255) ? wgc.get_C(c+1) : wgc.get_L_length()) - wgc.get_C(c);
+		// number of sources, checked by the container
+		sources = wgc.get_sources(); n = wgc.get_no_nodes();
 		// initialize range minimum query data structure
-		H = rmq_t(n);
+		H = rmq_t(n, path+".LCP");
 		// construct bucket index data structure
 		I = bit_vec_t(n);
 		// write bucket ids and init rank support
 		init_bucket_ids();
 		// initialize predecessor vector
-		init_predecessor_vector(basepath+".out", basepath+".L");
+		init_predecessor_vector(wgc.get_out(), wgc.get_L());
 		// initialize h to 1
 		h = 1;
 	}
@@ -300,16 +259,21 @@ public:
 	/* check LCP array correctness */
 	void check_output()
 	{
-		check_LCP_correctness<int_vector>(path,n,H.get_LCP_vector());
+		check_LCP_correctness<typename rmq_t::vector_type>(path,n,H.get_LCP_vector());
 	}
 
 	/* print LCP to file */
 	void to_file_LCP(std::string ofile_path)
 	{
-		FILE * ofile = std::fopen(ofile_path.c_str(), "w");
-		int_vector* LCP = H.get_LCP_vector();
-		fwrite(LCP->data(), LCP->width()/8, LCP->size(), ofile);
-		fclose(ofile);
+		store_LCP(ofile_path, *H.get_LCP_vector());
+	}
+
+	/* print LCP to file in the packed format */
+	void to_file_packed_LCP(std::string ofile_path)
+	{
+		auto* LCP = H.get_LCP_vector();
+		wg::write_packed_LCP(ofile_path, *LCP, LCP->size(), INF);
+		remove_LCP_file(path+".LCP", *LCP);
 	}
 
 	/* get input path */
@@ -17,7 +17,36 @@ namespace wg{
 
 class huff_wt{
 
+private:
+	// wavelet tree node
+	typedef sdsl::wt_huff<>::node_type node_type;
+	// maximum width of the ranges searched by reading their labels
+	static constexpr uint64_t NARROW_RANGE = 4;
+
+	/* node of the batched traversal with the ranges reaching it and their ids */
+	struct batch_frame{
+		node_type v;
+		sdsl::range_vec_type ranges;
+		std::vector<uint64_t> ids;
+	};
+
 public:
+	/*
+	 * buffers of the batched search: the results of the kth range are the entries
+	 * [offsets[k],offsets[k+1]) of cs, first and second; the other vectors are
+	 * scratch space of the traversal, kept to reuse their memory (the frames of
+	 * curr and next are a pool, reused by index across depths and calls)
+	 */
+	struct batch_buffer{
+		std::vector<uint64_t> offsets;
+		std::vector<char_wt> cs;
+		std::vector<uint_wt> first, second;
+		std::vector<std::pair<uint_wt,uint_wt>> ranges;
+		std::vector<uint64_t> hit_ids;
+		std::vector<char_wt> hit_cs;
+		std::vector<uint_wt> hit_first, hit_second;
+		std::vector<batch_frame> curr, next;
+	};
 
 	/* empty constructor */
 	huff_wt(){}
@@ -35,7 +64,32 @@ public:
 		}
 	}
 
-	char_t operator[](uint_t i){
+	/* constructor that builds a wt given the sequence in memory */
+	huff_wt(const uint8_t* seq, uint64_t len){
+		// copy sequence and compute huffman encoded wavelet tree
+		sdsl::int_vector<8> text(len);
+		std::memcpy(text.data(), seq, len);
+		sdsl::construct_im(wt, text, 0);
+		// compute distinct characters vector
+		distinct_element_in_range(0,size(),this->cs,this->cs_to_freq,this->freq);
+		// check alphabet size
+		if( cs_to_freq.size() < 1 ){
+			std::cerr << "Error! The alphabet is empty, exiting...\n";
+			exit(1);
+		}
+	}
+
+	/* serialize the wavelet tree to an output stream */
+	void serialize(std::ostream& out) const { wt.serialize(out); }
+
+	/* load a wavelet tree serialized with serialize() */
+	void load(std::istream& in){
+		wt.load(in);
+		// compute distinct characters vector
+		distinct_element_in_range(0,size(),this->cs,this->cs_to_freq,this->freq);
+	}
+
+	char_t operator[](uint64_t i){
 
 		assert(i<wt.size());
 		return wt[i];
@@ -50,21 +104,21 @@ public:
 	    return *this;
 	}
 
-	uint_t size(){
+	uint64_t size(){
 		return wt.size();
 	}
 
-	uint_t alphabet_size(){
+	uint64_t alphabet_size(){
 		return cs.size();
 	}
 
-	uint_t rank(uint_t i, char_t c){
+	uint64_t rank(uint64_t i, char_t c){
 
 		assert(i<=wt.size());
 		return wt.rank(i,c);
 	}
 
-	uint_t select(uint_t i, char_t c){
+	uint64_t select(uint64_t i, char_t c){
 
 		return wt.select(i+1,c);
 	}
@@ -73,8 +127,8 @@ public:
 	void distinct_element_in_range(uint_wt i, uint_wt j, std::vector<char_wt>& cs,
 		                           std::vector<char_wt>& cs_to_freq,std::vector<uint_wt>& freq)
 	{
-		// alphabet size - ASCII alphabet
-		uint_wt k = 128;
+		// alphabet size - byte alphabet
+		uint_wt k = 256;
 		// initialize alphabet and frequencies vector
 		cs.resize(k); freq.resize(k); std::iota(std::begin(cs), std::end(cs), 0);
 		// search character frequencies in the wavelet tree
@@ -82,7 +136,130 @@ public:
 		// keeps character with a positive frequency
 		cs.resize(k); freq.resize(k);
 		// compute characters mapping
-		cs_to_freq.resize(128); for(uint_t i=0;i<k;++i){cs_to_freq[cs[i]]=i;}
+		cs_to_freq.resize(256); for(uint64_t i=0;i<k;++i){cs_to_freq[cs[i]]=i;}
+	}
+
+	/*
+	 * wrapper to interval_symbols function writing the distinct characters of
+	 * [i,j) and their ranks at i and j in caller-owned buffers, which are only
+	 * grown up to the alphabet size; returns the number of distinct characters
+	 */
+	uint64_t search_intervals_in_range(uint_wt i, uint_wt j, std::vector<char_wt>& cs_,
+	                                   std::vector<uint_wt>& rank_i, std::vector<uint_wt>& rank_j)
+	{
+		assert(cs.size() > 0);
+		// grow the buffers to the alphabet size
+		if( cs_.size() < cs.size() )
+			{ cs_.resize(cs.size()); rank_i.resize(cs.size()); rank_j.resize(cs.size()); }
+		uint_wt k = 0;
+		// narrow ranges, e.g. the out-edges of a single node: read each label
+		// and its rank with one descent instead of the full interval_symbols
+		if( j - i <= NARROW_RANGE )
+		{
+			// characters seen so far, the labels are bytes
+			uint64_t seen[4] = {0,0,0,0};
+			for(uint_wt p=i;p<j;++p)
+			{
+				auto rc = wt.inverse_select(p);
+				char_wt c = rc.second;
+				if( !(seen[c >> 6] & (uint64_t(1) << (c & 63))) )
+				{
+					seen[c >> 6] |= uint64_t(1) << (c & 63);
+					cs_[k] = c; rank_i[k] = rc.first; rank_j[k] = rc.first + 1; k++;
+				}
+				else
+				{
+					uint_wt x = 0;
+					while(cs_[x] != c){ x++; }
+					rank_j[x]++;
+				}
+			}
+			return k;
+		}
+		// search character frequencies in the wavelet tree
+		sdsl::interval_symbols(wt,i,j,k,cs_,rank_i,rank_j);
+
+		return k;
+	}
+
+	/*
+	 * batched version of search_intervals_in_range for the ranges [i,j) in
+	 * buf.ranges: the ranges are pushed through the wavelet tree one depth at a
+	 * time, so that all ranks on the bitvector of a node are computed together
+	 * (in increasing position order if the ranges are sorted) instead of one
+	 * root-to-leaves descent per range; the results are grouped by range in buf
+	 */
+	void search_intervals_in_range_batched(batch_buffer& buf)
+	{
+		uint64_t m = buf.ranges.size();
+		buf.hit_ids.clear(); buf.hit_cs.clear(); buf.hit_first.clear(); buf.hit_second.clear();
+		// get the ith frame of a pool, emptied and set to node v
+		auto get_frame = [](std::vector<batch_frame>& pool, uint64_t i, node_type v) -> batch_frame&
+		{
+			if(pool.size() <= i){ pool.resize(i+1); }
+			batch_frame& g = pool[i];
+			g.v = v; g.ranges.clear(); g.ids.clear();
+			return g;
+		};
+		// start from the root with the non-empty ranges
+		batch_frame& root = get_frame(buf.curr, 0, wt.root());
+		for(uint64_t k=0;k<m;++k)
+			if(buf.ranges[k].first < buf.ranges[k].second)
+			{
+				root.ranges.push_back({{buf.ranges[k].first, buf.ranges[k].second-1}});
+				root.ids.push_back(k);
+			}
+		// number of frames of the current and next depth
+		uint64_t no_curr = root.ranges.empty() ? 0 : 1, no_next;
+		// visit the tree one depth at a time
+		while(no_curr > 0)
+		{
+			no_next = 0;
+			for(uint64_t x=0;x<no_curr;++x)
+			{
+				batch_frame& f = buf.curr[x];
+				if(wt.is_leaf(f.v))
+				{
+					// the leaf ranges are the ranks of its symbol
+					char_wt c = wt.sym(f.v);
+					for(uint64_t k=0;k<f.ranges.size();++k)
+					{
+						buf.hit_ids.push_back(f.ids[k]); buf.hit_cs.push_back(c);
+						buf.hit_first.push_back(f.ranges[k][0]); buf.hit_second.push_back(f.ranges[k][1]+1);
+					}
+					continue;
+				}
+				// map all the ranges of the node on its children
+				auto children = wt.expand(f.v);
+				auto child_ranges = wt.expand(f.v, f.ranges);
+				for(uint64_t b=0;b<2;++b)
+				{
+					batch_frame& g = get_frame(buf.next, no_next, children[b]);
+					for(uint64_t k=0;k<f.ranges.size();++k)
+						if(not sdsl::empty(child_ranges[b][k]))
+						{
+							g.ranges.push_back(child_ranges[b][k]); g.ids.push_back(f.ids[k]);
+						}
+					// an empty frame is overwritten by the next child
+					if(not g.ranges.empty()){ no_next++; }
+				}
+			}
+			buf.curr.swap(buf.next); no_curr = no_next;
+		}
+		// group the results by range with a counting sort
+		buf.offsets.assign(m+1,0);
+		for(auto k : buf.hit_ids){ buf.offsets[k+1]++; }
+		for(uint64_t k=0;k<m;++k){ buf.offsets[k+1] += buf.offsets[k]; }
+		uint64_t h = buf.hit_ids.size();
+		buf.cs.resize(h); buf.first.resize(h); buf.second.resize(h);
+		for(uint64_t x=0;x<h;++x)
+		{
+			uint64_t pos = buf.offsets[buf.hit_ids[x]]++;
+			buf.cs[pos] = buf.hit_cs[x]; buf.first[pos] = buf.hit_first[x]; buf.second[pos] = buf.hit_second[x];
+		}
+		// restore the offsets
+		for(uint64_t k=m;k>0;--k){ buf.offsets[k] = buf.offsets[k-1]; }
+		buf.offsets[0] = 0;
 	}
 
 	/* wrapper to interval_symbols function */
@@ -114,14 +291,14 @@ public:
 	}
 
 	/* wrapper to wavelet tree rank function */
-	uint_t rank(char_t c, uint_wt i)
+	uint64_t rank(char_t c, uint_wt i)
 	{
 		assert(i <= wt.size());
 		return wt.rank(i,c);
 	}
 
 	/* wrapper to wavelet tree select function */
-	uint_t select(char_t c, uint_wt i)
+	uint64_t select(char_t c, uint_wt i)
 	{
 		assert(i <= wt.size());
 		return wt.select(i,c);
@@ -131,21 +308,21 @@ public:
 	std::vector<char_wt> alphabet_characters(){ return cs; }
 
 	/* return alphabet size */
-	uint_t alph_size()
+	uint64_t alph_size()
 	{
 		assert(cs.size() == freq.size());
 		return cs.size();
 	}
 
 	/* return i-th char in the alphabet */
-	char_wt at_char(uint_t i)
+	char_wt at_char(uint64_t i)
 	{
 		assert(i<cs.size());
 		return cs[i];
 	}
 
 	/* return frequency of the i-th char in the alphabet */
-	uint_wt at_freq(uint_t i)
+	uint_wt at_freq(uint64_t i)
 	{
 		assert(i<freq.size());
 		return freq[i];
@@ -154,12 +331,12 @@ public:
 	/* return frequency of a character */
 	uint_wt char_freq(uint_wt c)
 	{
-		assert(c<128);
+		assert(c<256);
 		return freq[cs_to_freq[c]];
 	}
 
 	/* return ith character in the wt */
-	uint_wt at(uint_t i)
+	uint_wt at(uint64_t i)
 	{
 		assert(i < wt.size());
 		return wt[i];
@@ -3,60 +3,254 @@
 // by a MIT license that can be found in the LICENSE file.
 
 /*
- *  hybrid_queue: Implementation of the hybrid queue from Beller et al. paper
+ *  hybrid_queue: Implementation of the hybrid queue from Beller et al. paper.
+ *                In the sorted mode, the intervals of a level stored in the STL
+ *                regime are radix-sorted by left endpoint before being popped, so
+ *                that the index is accessed roughly left to right as in the
+ *                bitvector regime. The mid-sized levels, between the STL and the
+ *                bitvector regimes, are stored in a compressed regime: runs of
+ *                values sorted by left endpoint and delta-encoded with variable
+ *                length bytes, popped in order by merging the runs. The FIFO of
+ *                the STL regime is a ring buffer preallocated from the trigger.
  */
 
 #ifndef INTERNAL_HYBRID_QUEUE_HPP_
 #define INTERNAL_HYBRID_QUEUE_HPP_
 
+#include <chrono>
+
 #include "common.hpp"
+#include "ring_buffer.hpp"
 
 typedef std::pair<uint_t,uint_t> interval;
 typedef sdsl::bit_vector sdsl_bvec;
 
 namespace wg{
 
-template<typename queue_t>
+template<typename queue_t, class uint_t = ::uint_t>
 class hybrid_queue{
 
 private:
-	/* init bitvectors for the LCP+1 intervals */
-	void init_next_bitvec_queue()
+	// interval of the index width
+	typedef std::pair<uint_t,uint_t> interval;
+
+	/* clear the dirty words of the bitvectors with index x */
+	void clear_bitvecs(uint8_t x)
 	{
-		// (re-)init bitvectors for the queue intervals associated to the next LCP value 
-		if( Bn == nullptr ){ Bn = new sdsl_bvec(bit_size_pad,0); En = new sdsl_bvec(bit_size_pad,0); }
-		else{ for(uint_t i=0;i<bit_size;++i){ (*Bn)[i] = 0; (*En)[i] = 0; } /*Bn->bit_resize(0); Bn->bit_resize(bit_size);*/ }
+		if( dirty_lo[x] < dirty_hi[x] )
+		{
+			uint64_t len = (dirty_hi[x]-dirty_lo[x])*sizeof(uint64_t);
+			memset(Bv[x].data()+dirty_lo[x], 0, len);
+			if( Ev[x].size() > 0 ){ memset(Ev[x].data()+dirty_lo[x], 0, len); }
+		}
+		dirty_lo[x] = UINT64_MAX; dirty_hi[x] = 0;
 	}
-	void init_next_bitvec_queue_single()
+
+	/* init bitvectors for the LCP+1 intervals */
+	void init_next_bitvec_queue(bool_t pairs = true)
 	{
-		// (re-)init bitvector for the queue values associated to the next LCP value 
-		if( Bn == nullptr ){ Bn = new sdsl_bvec(bit_size_pad,0); }
-		else{ for(uint_t i=0;i<bit_size;++i){ (*Bn)[i] = 0; } }
+		// (re-)init bitvectors for the queue intervals associated to the next LCP value,
+		// allocated at the first use and then only cleared over their dirty words
+		uint8_t x = curr^1;
+		if( Bv[x].size() == 0 ){ Bv[x] = sdsl_bvec(bit_size_pad,0); }
+		if( pairs and Ev[x].size() == 0 ){ Ev[x] = sdsl_bvec(bit_size_pad,0); }
+		clear_bitvecs(x);
+		Bn = &Bv[x]; En = pairs ? &Ev[x] : nullptr;
 	}
+	void init_next_bitvec_queue_single(){ init_next_bitvec_queue(false); }
 
-	/* swap pointers for the bitvector queue */
+	/* swap the current and next bitvector queues */
 	void swap_bitvec_queue()
 	{
 		// swap queues
-		std::swap(B,Bn); std::swap(E,En);
+		curr ^= 1;
+		B = &Bv[curr]; E = Ev[curr].size() > 0 ? &Ev[curr] : nullptr;
+		Bn = En = nullptr;
 	}
-	void swap_bitvec_queue_single() { std::swap(B,Bn); }
+	void swap_bitvec_queue_single() { swap_bitvec_queue(); }
 
-	/* delete current LCP value bitvector based queue */
-	void delete_curr_bitvec_queue()
+	/* mark as dirty the words of the next bitvectors containing i and j */
+	void mark_dirty(uint_t i, uint_t j)
 	{
-		// free pointers
-		if( B != nullptr ){ delete B; delete E; B = E = nullptr; }
+		uint8_t x = curr^1;
+		dirty_lo[x] = std::min<uint64_t>(dirty_lo[x], i/64);
+		dirty_hi[x] = std::max<uint64_t>(dirty_hi[x], j/64+1);
 	}
-	void delete_curr_bitvec_queue_single(){ if( B != nullptr ){ delete B; B = nullptr; } }
 
-	/* delete next LCP value bitvector based queue */
-	void delete_next_bitvec_queue()
+	/*
+	* set the switch point between the two regimes from the cost of a push and a pop
+	* in each regime, measured on a sample, and from the memory of the bitvectors. A
+	* level in the bitvector regime costs a * size + b * (words scanned), a level in
+	* the STL regime c * size: the bitvector regime is used when it is faster, or when
+	* the STL level would take more memory than the bitvectors of the two levels, which
+	* are allocated anyway; there is no configurable memory budget. The switch point
+	* is at most the one of Beller et al., which also accounts for the left to right
+	* access of the index in the bitvector regime.
+	*/
+	void calibrate_trigger(uint64_t n, uint64_t bitvecs)
 	{
-		// free pointers
-		if( Bn != nullptr ){ delete Bn; delete En; Bn = En = nullptr; }
+		trigger = stab_flag ? n/log(n) : n/(2*log(n));
+		// the STL level must not take more memory than the bitvectors
+		uint64_t mem_trigger = (bitvecs * 2 * bit_size_pad / 8) / sizeof(queue_t);
+		trigger = std::min<uint64_t>(trigger, mem_trigger);
+		// not worth measuring on small inputs
+		if( n < (1 << 20) ){ return; }
+		auto ns = [](std::chrono::steady_clock::time_point t){
+			return double(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t).count()); };
+		// sample of m values spread over r bits
+		const uint64_t m = (1 << 16), r = std::min<uint64_t>(bit_size_pad, uint64_t(1) << 26);
+		// STL regime
+		ring_buffer<queue_t> q(m);
+		auto t = std::chrono::steady_clock::now();
+		for(uint64_t x=0;x<m;++x){ q.push(queue_t()); }
+		while(not q.empty()){ volatile queue_t v = q.front(); (void)v; q.pop(); }
+		double c = ns(t) / m;
+		// bitvector regime with m and m/8 values, to separate the cost of the scan
+		sdsl_bvec bv(r + 64, 0);
+		double time[2]; uint64_t cnt[2] = {m, m/8};
+		for(int k=0;k<2;++k)
+		{
+			uint64_t stride = r / cnt[k];
+			t = std::chrono::steady_clock::now();
+			for(uint64_t x=0;x<cnt[k];++x){ bv[x*stride] = 1; }
+			uint64_t w = 0; volatile uint64_t sink = 0;
+			for(uint64_t x=0;x<cnt[k];++x)
+			{
+				uint64_t word;
+				while( (word = bv.get_int(w)) == 0 ){ w += 64; }
+				uint64_t p = w + __builtin_ctzll(word);
+				bv[p] = 0; sink = p;
+			}
+			(void)sink;
+			time[k] = ns(t);
+		}
+		double a = std::max((time[0]-time[1]) / (m - m/8), 0.1);
+		double b = std::max((time[0] - a*m) / (r/64), 0.01);
+		// bitvectors scanned by the pops of a level
+		double words = bitvecs * double(bit_size_pad) / 64;
+		if( c > a ){ trigger = std::min<double>(trigger, b * words / (c - a)); }
+	}
+
+	/* sort key of an interval or of a value */
+	static uint_t key(const interval& x){ return x.first; }
+	static uint_t key(const uint_t x){ return x; }
+
+	/* append x to b in variable length bytes, 7 bits per byte */
+	static void put_varint(std::vector<uint8_t>& b, uint64_t x)
+	{
+		while( x >= 128 ){ b.push_back(uint8_t(x) | 128); x >>= 7; }
+		b.push_back(uint8_t(x));
+	}
+	/* read a variable length value at b[p], advancing p */
+	static uint64_t get_varint(const std::vector<uint8_t>& b, uint64_t& p)
+	{
+		uint64_t x = 0; uint8_t shift = 0;
+		while( b[p] & 128 ){ x |= uint64_t(b[p++] & 127) << shift; shift += 7; }
+		return x | (uint64_t(b[p++]) << shift);
+	}
+	/* encode an interval or a value given the key of the previous one of its run */
+	static void encode(std::vector<uint8_t>& b, const interval& x, uint_t prev)
+	{
+		assert(x.second >= x.first);
+		put_varint(b, x.first - prev); put_varint(b, x.second - x.first);
+	}
+	static void encode(std::vector<uint8_t>& b, const uint_t x, uint_t prev){ put_varint(b, x - prev); }
+	/* decode an interval or a value given the key of the previous one of its run */
+	static void decode(const std::vector<uint8_t>& b, uint64_t& p, interval& x, uint_t prev)
+	{
+		x.first = prev + get_varint(b, p); x.second = x.first + get_varint(b, p);
+	}
+	static void decode(const std::vector<uint8_t>& b, uint64_t& p, uint_t& x, uint_t prev){ x = prev + get_varint(b, p); }
+
+	/* sort the staged values of the next compressed level and encode them as a new run */
+	void flush_packed_run()
+	{
+		if( stage.empty() ){ return; }
+		std::sort(stage.begin(), stage.end(), [](const queue_t& a, const queue_t& b){ return key(a) < key(b); });
+		next_runs.push_back(next_bytes.size());
+		uint_t prev = 0;
+		for(auto& x : stage){ encode(next_bytes, x, prev); prev = key(x); }
+		stage.clear();
+	}
+
+	/* move the next compressed level to the current one and start merging its runs */
+	void start_packed_level()
+	{
+		flush_packed_run();
+		curr_bytes.swap(next_bytes); next_bytes.clear();
+		curr_runs.swap(next_runs); next_runs.clear();
+		curr_runs.push_back(curr_bytes.size());
+		// cursor on the first value of each run
+		uint64_t k = curr_runs.size()-1;
+		cursors.resize(k);
+		for(uint64_t r=0;r<k;++r)
+		{
+			cursors[r].pos = curr_runs[r];
+			decode(curr_bytes, cursors[r].pos, cursors[r].val, 0);
+			heap.push(std::make_pair(key(cursors[r].val), r));
+		}
+		size = packed_set; packed_set = 0;
+	}
+
+	/* pop the smallest value of the current compressed level */
+	void pop_packed(queue_t& x)
+	{
+		uint64_t r = heap.top().second; heap.pop();
+		x = cursors[r].val;
+		// advance the run
+		if( cursors[r].pos < curr_runs[r+1] )
+		{
+			decode(curr_bytes, cursors[r].pos, cursors[r].val, key(x));
+			heap.push(std::make_pair(key(cursors[r].val), r));
+		}
+		size--;
+	}
+
+	/* set the regime of the next level from the size of the current one */
+	bool_t set_next_regime(bool_t pairs)
+	{
+		Packed2 = false;
+		// if queue is empty return false
+		if( size == 0 ){ return false; }
+		// set next switch
+		if( size > trigger ){
+			// set switch on and init bitvectors
+			Switch2 = true;
+			init_next_bitvec_queue(pairs);
+		}
+		else{
+			// set switch off, the bitvectors are kept for the next dense level;
+			// the mid-sized levels are compressed
+			Switch2 = false;
+			Packed2 = size > packed_trigger;
+		}
+		// return true is size > 0
+		return true;
+	}
+
+	/* move the pending values of the next level to the current level, sorted by key */
+	void sort_next_level()
+	{
+		curr_vec.swap(next_vec); next_vec.clear(); curr_i = 0;
+		// small levels are sorted by comparison
+		if( curr_vec.size() < 1024 )
+		{
+			std::sort(curr_vec.begin(), curr_vec.end(), [](const queue_t& a, const queue_t& b){ return key(a) < key(b); });
+			return;
+		}
+		// LSD radix sort on the bytes of the key up to the largest one
+		uint_t max = 0;
+		for(auto& x : curr_vec){ max = std::max(max, key(x)); }
+		tmp_vec.resize(curr_vec.size());
+		for(uint64_t shift=0; shift<sizeof(uint_t)*8 and (uint64_t(max) >> shift) > 0; shift+=8)
+		{
+			uint64_t count[257] = {0};
+			for(auto& x : curr_vec){ count[((key(x) >> shift) & 0xff) + 1]++; }
+			for(uint64_t d=0;d<256;++d){ count[d+1] += count[d]; }
+			for(auto& x : curr_vec){ tmp_vec[count[(key(x) >> shift) & 0xff]++] = x; }
+			curr_vec.swap(tmp_vec);
+		}
 	}
-	void delete_next_bitvec_queue_single(){ if( Bn != nullptr ){ delete Bn; Bn = nullptr; } }
 	
 public:
 	// empty constructor
@@ -66,26 +260,32 @@ public:
 	* the hybrid index constisting of the classic STL queue + two bit vectors encoding
 	* the beginnings and ends of the intervals.
 	*/
-	hybrid_queue(uint_t n,bool_t flag = false): bit_size(n+1), stab_flag(flag)
+	hybrid_queue(uint_t n,bool_t flag = false,bool_t sorted_ = false): bit_size(n+1), stab_flag(flag), sorted(sorted_)
 	{
 		// initialize queue size
-		size = 0;
+		size = 0; packed_set = 0;
 		// initialize l value
 		l = INF;
 		// we start with the classic queue type
-		Switch = false; Switch2 = false;
+		Switch = false; Switch2 = false; Packed = false; Packed2 = false;
 		// no ones in bit vector
 		bit_set = 0;
-		// compute queue change trigger
-		trigger = n/(2*log(n));
 		// set pointers to null
 		B = E = Bn = En = nullptr; 
 		// set 64 bits padded length
 		bit_size_pad = ((bit_size/64)+1)*64 + 1;
-		// set trigger for interval stabbing algorithm
-		if(stab_flag){ trigger = n/log(n); }
+		// compute queue change trigger, the interval stabbing algorithm uses one bitvector
+		calibrate_trigger(n, stab_flag ? 1 : 2);
+		// the levels just below the trigger use the compressed regime
+		packed_trigger = trigger/4 > PACKED_RUN ? trigger/4 : PACKED_RUN;
+		// the FIFO holds the current and the next level, which fit in the ring
+		// buffer as long as the levels stay below the compressed regime
+		if( not sorted ){ queue_pair.reserve(2*packed_trigger); }
 	}
 
+	hybrid_queue(const hybrid_queue&) = delete;
+	hybrid_queue & operator= (const hybrid_queue&) = delete;
+
 	/* push new interval in the queue */
 	void push(uint_t i, uint_t j)
 	{
@@ -95,11 +295,20 @@ public:
 			assert(i < bit_size and j < bit_size);
 			// set the two interval bits
 			(*Bn)[i] = 1; (*En)[j] = 1;
+			mark_dirty(i,j);
 			// increase bit counter
 			bit_set++;
 
 		}
+		// push in the compressed level
+		else if( Packed2 )
+		{
+			stage.push_back(std::make_pair(i,j)); packed_set++;
+			if( stage.size() >= PACKED_RUN ){ flush_packed_run(); }
+		}
 		// push in the the STL queue
+		else if( sorted )
+			next_vec.push_back(std::make_pair(i,j));
 		else
 			queue_pair.push(std::make_pair(i,j));
 	}
@@ -113,11 +322,20 @@ public:
 			assert(i < bit_size);
 			// set the value as contained
 			(*Bn)[i] = 1;
+			mark_dirty(i,i);
 			// increase bit counter
 			bit_set++;
 
 		}
+		// push in the compressed level
+		else if( Packed2 )
+		{
+			stage.push_back(i); packed_set++;
+			if( stage.size() >= PACKED_RUN ){ flush_packed_run(); }
+		}
 		// push in the the STL queue
+		else if( sorted )
+			next_vec.push_back(i);
 		else
 			queue_pair.push(i);
 	}
@@ -128,7 +346,7 @@ public:
 		// increase LCP value
 		l++;
 		// update switch
-		Switch = Switch2;
+		Switch = Switch2; Packed = Packed2;
 		// setup queue type
 		if( Switch ){
 			//std::cout << "SET BITVEC QUEUE\n";
@@ -137,31 +355,18 @@ public:
 			swap_bitvec_queue();
 			bit_set = B_i = E_i = 0;
 		}
+		else if( Packed ){
+			// set compressed queue
+			start_packed_level();
+		}
 		else{
 			// set STL queue
-			size = queue_pair.size();
-			// delete old bitvector queue
-			delete_curr_bitvec_queue();
+			if( sorted ){ sort_next_level(); }
+			size = sorted ? curr_vec.size() : queue_pair.size();
 		}
 
-		// if queue is empty return false
-		if( size == 0 ){ return false; }
-
-		// set next switch
-		if( size > trigger ){
-			// set switch on and init bitvectors	
-			Switch2 = true;
-			init_next_bitvec_queue();
-		}
-		else{
-			// set switch on and delete bitvectors
-			Switch2 = false;
-			// delete old bitvector queue
-			delete_next_bitvec_queue();
-		}
-		
-		// return true is size > 0
-		return true;
+		// set the next queue type, return false if the queue is empty
+		return set_next_regime(true);
 	}
 
 	/* set up queue for the next LCP value in the 
@@ -171,36 +376,25 @@ public:
 		// increase LCP value
 		l++;
 		// update switch
-		Switch = Switch2;
+		Switch = Switch2; Packed = Packed2;
 		// setup queue type
 		if( Switch ){
 			// set bitvector queue
 			size = bit_set; bit_set = B_i = 0;
 			swap_bitvec_queue_single();
 		}
+		else if( Packed ){
+			// set compressed queue
+			start_packed_level();
+		}
 		else{
 			// set STL queue
-			size = queue_pair.size();
-			// delete old bitvector queue
-			delete_curr_bitvec_queue_single();
+			if( sorted ){ sort_next_level(); }
+			size = sorted ? curr_vec.size() : queue_pair.size();
 		}
 
-		// if queue is empty return false
-		if( size == 0 ){ return false; }
-
-		// set next switch
-		if( size > trigger ){
-			// set switch on and init bitvectors	
-			Switch2 = true; init_next_bitvec_queue_single();
-		}
-		else{
-			//std::cout << "DELETE NEXT BITVEC QUEUE\n";
-			// set switch on and delete bitvectors
-			Switch2 = false; delete_next_bitvec_queue_single();
-		}
-		
-		// return true is size > 0
-		return true;
+		// set the next queue type, return false if the queue is empty
+		return set_next_regime(false);
 	}
 
 	/* get queue front and pop it */
@@ -222,9 +416,21 @@ public:
 
 			// set the two leftmost bits to zero
 			(*B)[b_i] = 0; (*E)[e_i] = 0;
+			if( size == 0 ){ dirty_lo[curr] = UINT64_MAX; dirty_hi[curr] = 0; }
 
 			i.first = b_i; i.second = e_i;
 		}
+		// pop from the compressed level
+		else if( Packed )
+		{
+			pop_packed(i);
+		}
+		// pop from the sorted level
+		else if( sorted )
+		{
+			i = curr_vec[curr_i++];
+			size--;
+		}
 		// pop from STL queue
 		else
 		{
@@ -251,9 +457,21 @@ public:
 
 			// set the leftmost bit to zero
 			(*B)[b_i] = 0;
+			if( size == 0 ){ dirty_lo[curr] = UINT64_MAX; dirty_hi[curr] = 0; }
 
 			i = b_i;
 		}
+		// pop from the compressed level
+		else if( Packed )
+		{
+			pop_packed(i);
+		}
+		// pop from the sorted level
+		else if( sorted )
+		{
+			i = curr_vec[curr_i++];
+			size--;
+		}
 		// pop from STL queue
 		else
 		{
@@ -286,6 +504,13 @@ public:
 		}
 	}
 
+	/* tell if the current level is stored in the bitvector regime, i.e. it is
+	   dense and it is popped in increasing order */
+	bool_t bitvector_level()
+	{
+		return Switch;
+	}
+
 	/* get current LCP value */
 	uint_t get_l()
 	{
@@ -305,15 +530,19 @@ public:
 	} 
 
 private:
-	// classic queue containing pair intervals
-	std::queue<queue_t> queue_pair;
+	// FIFO queue containing pair intervals
+	ring_buffer<queue_t> queue_pair;
 	// size of the queue
 	uint_t size;
 	// current l value
 	uint_t l;
-	// bit vector queue
+	// bit vector queue: current and next level bitvectors, pointing to the double buffers
 	sdsl_bvec* B; sdsl_bvec* E;
 	sdsl_bvec* Bn; sdsl_bvec* En;
+	sdsl_bvec Bv[2], Ev[2];
+	// index of the current level buffers, dirty word range [lo,hi) of each buffer
+	uint8_t curr = 0;
+	uint64_t dirty_lo[2] = {UINT64_MAX,UINT64_MAX}, dirty_hi[2] = {0,0};
 	// bit vectors size
 	uint_t bit_size;
 	uint_t bit_size_pad;
@@ -321,13 +550,37 @@ private:
 	uint_t bit_set;
 	// bitvector front indexes
 	uint_t B_i, E_i;
-	// switch between two queues
+	// switch between two queues, compressed current and next levels
 	bool_t Switch, Switch2;
+	bool_t Packed, Packed2;
 	// limit to trigger switch
 	uint_t trigger;
 	/* flag saying if we are using the queue
 	 * for the interval stabbing algorithm */
 	bool_t stab_flag;
+	// flag saying if the STL regime levels are sorted
+	bool_t sorted = false;
+	// current and next level of the sorted STL regime, radix sort buffer
+	std::vector<queue_t> curr_vec, next_vec, tmp_vec;
+	uint64_t curr_i = 0;
+	// values of a run of the compressed regime, minimum size of a compressed level
+	static constexpr uint64_t PACKED_RUN = 4096;
+	uint64_t packed_trigger;
+	// values pushed to the next compressed level since the last run
+	std::vector<queue_t> stage;
+	uint64_t packed_set;
+	// encoded runs of the current and next compressed levels and their byte offsets
+	std::vector<uint8_t> curr_bytes, next_bytes;
+	std::vector<uint64_t> curr_runs, next_runs;
+	// cursor on a run of the current compressed level: next byte and current value
+	struct run_cursor{
+		uint64_t pos;
+		queue_t val;
+	};
+	std::vector<run_cursor> cursors;
+	// min-heap of (key, run) of the current values of the runs
+	std::priority_queue<std::pair<uint_t,uint64_t>, std::vector<std::pair<uint_t,uint64_t>>,
+	                    std::greater<std::pair<uint_t,uint64_t>>> heap;
 };
 
 }
@@ -0,0 +1,229 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  index_cache: persistent file storing the FM-index and the packed BWT of the
+ *               interval stabbing data structure of a Wheeler pseudoforest, so
+ *               that they are built only once. The file layout is:
+ *
+ *      header:     magic, version, sizeof(uint_t), out bitvector format,
+ *                  input fingerprint, FM-index offset and bytes, packed BWT
+ *                  offset and bytes, flag saying if the wavelet tree is stored
+ *      FM-index:   sdsl serialization of the out bitvector with its rank/select
+ *                  support (or its explicit mapping), the C array, the sources,
+ *                  the number of edges and the wavelet tree, which is read only
+ *                  by the Beller et al. algorithm
+ *      packed BWT: interval stabbing header, rank samples, blocks and crossing
+ *                  entries, starting at a page boundary
+ *
+ *  The file is mapped privately (copy-on-write): the packed BWT is used in place
+ *  and the writes of the queries never reach the file. The fingerprint stores the
+ *  size and modification time of the input files; a stale cache is rebuilt.
+ *  The cache is written to a temporary file renamed once complete, and the
+ *  sections of the header are checked against the file size before loading.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_INDEX_CACHE_HPP_
+#define INTERNAL_INDEX_CACHE_HPP_
+
+#include <fstream>
+#include <streambuf>
+
+#include "common.hpp"
+#include "WG_string.hpp"
+#include "interval_stabbing.hpp"
+
+namespace wg{
+
+/* header of the index cache */
+struct index_cache_header{
+	uint64_t magic;
+	uint64_t version;
+	uint64_t word_size;
+	uint64_t out_type;
+	uint64_t fingerprint;
+	uint64_t fm_offset;
+	uint64_t fm_bytes;
+	uint64_t packed_offset;
+	uint64_t packed_bytes;
+	uint64_t has_wt;
+};
+
+template<class wfmi_t>
+class index_cache{
+
+private:
+	// index width
+	typedef typename wfmi_t::uint_type uint_t;
+	// "WGIDX001" in little-endian
+	static constexpr uint64_t MAGIC = 0x3130305844494757ULL;
+	static constexpr uint64_t VERSION = 8;
+	// alignment of the packed BWT in the file
+	static constexpr uint64_t PAGE = 4096;
+
+	/* read-only stream buffer over a memory area */
+	struct membuf : std::streambuf{
+		membuf(char* b, size_t len){ setg(b, b, b+len); }
+	};
+
+	/* compute the fingerprint of the input files from their size and modification time */
+	static uint64_t fingerprint(const std::vector<std::string>& files)
+	{
+		uint64_t fp = 0;
+		for(auto& f : files)
+		{
+			struct stat st;
+			if(stat(f.c_str(), &st) != 0){ std::cerr << "Error! cannot open " << f << ", exiting...\n"; exit(1); }
+			fp = (fp * 1000003) ^ uint64_t(st.st_size);
+			fp = (fp * 1000003) ^ uint64_t(st.st_mtim.tv_sec);
+			fp = (fp * 1000003) ^ uint64_t(st.st_mtim.tv_nsec);
+		}
+		return fp;
+	}
+
+	/*
+	* map the cache file and load the FM-index, with its wavelet tree if load_wt is
+	* true; return false if missing or stale, or if the wavelet tree is not stored
+	*/
+	bool load(std::string filepath, std::string basepath, uint64_t fp, bool load_wt)
+	{
+		int fd = open(filepath.c_str(), O_RDONLY);
+		if(fd < 0){ return false; }
+		struct stat st; fstat(fd, &st);
+		if(uint64_t(st.st_size) < sizeof(index_cache_header)){ close(fd); return false; }
+		void* addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(addr == MAP_FAILED){ return false; }
+		base = static_cast<char*>(addr); size = st.st_size;
+		// check header
+		const index_cache_header* h = reinterpret_cast<const index_cache_header*>(base);
+		if(h->magic != MAGIC or h->version != VERSION or h->word_size != sizeof(uint_t) or
+		   h->out_type != wfmi_t::out_type_id() or h->fingerprint != fp or (load_wt and not h->has_wt))
+		{
+			munmap(base, size); base = nullptr; size = 0;
+			return false;
+		}
+		// check the sections: the FM-index follows the header and the packed BWT
+		// follows the FM-index at a page boundary
+		if(h->fm_offset != sizeof(index_cache_header) or h->fm_bytes > size or
+		   h->fm_offset + h->fm_bytes > h->packed_offset or h->packed_offset % PAGE != 0 or
+		   h->packed_offset > size or h->packed_bytes > size - h->packed_offset)
+		{
+			munmap(base, size); base = nullptr; size = 0;
+			return false;
+		}
+		// deserialize the FM-index
+		membuf buf(base + h->fm_offset, h->fm_bytes);
+		std::istream in(&buf);
+		fm_index.load(in, basepath, load_wt);
+		if(!in)
+		{
+			munmap(base, size); base = nullptr; size = 0;
+			return false;
+		}
+		// use the packed BWT in place
+		stab = new interval_stabbing<wfmi_t>(base + h->packed_offset, fm_index.get_L_length(), &fm_index);
+		// the block width depends on the alphabet, check the layout size
+		if(stab->get_packed_BWT_bytes() != h->packed_bytes)
+		{
+			delete stab; stab = nullptr;
+			munmap(base, size); base = nullptr; size = 0;
+			return false;
+		}
+
+		return true;
+	}
+
+	/*
+	* write the FM-index and the packed BWT to a temporary file renamed to the cache
+	* file once complete, so that an interrupted run never leaves a valid header
+	*/
+	void store(std::string filepath, uint64_t fp, bool has_wt)
+	{
+		std::string tmppath = filepath + ".tmp";
+		std::ofstream out(tmppath, std::ios::binary);
+		if(!out){ std::cerr << "Error! cannot open " << tmppath << ", exiting...\n"; exit(1); }
+		index_cache_header h; memset(&h, 0, sizeof(h));
+		h.magic = MAGIC; h.version = VERSION; h.word_size = sizeof(uint_t);
+		h.out_type = wfmi_t::out_type_id(); h.fingerprint = fp; h.has_wt = has_wt;
+		// write FM-index after the header
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		h.fm_offset = sizeof(h);
+		fm_index.serialize(out);
+		h.fm_bytes = uint64_t(out.tellp()) - h.fm_offset;
+		// write packed BWT at the next page boundary
+		h.packed_offset = ((h.fm_offset + h.fm_bytes + PAGE - 1) / PAGE) * PAGE;
+		h.packed_bytes = stab->get_packed_BWT_bytes();
+		std::vector<char> pad(h.packed_offset - h.fm_offset - h.fm_bytes, 0);
+		out.write(pad.data(), pad.size());
+		out.write(stab->get_packed_BWT(), h.packed_bytes);
+		// rewrite header
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		out.close();
+		if(!out or rename(tmppath.c_str(), filepath.c_str()) != 0)
+		{
+			std::cerr << "Error! cannot write " << filepath << ", exiting...\n";
+			remove(tmppath.c_str());
+			exit(1);
+		}
+	}
+
+public:
+	/*
+	* Constructor that loads the index cache [basepath].idx or, if it is missing
+	* or stale, builds the FM-index and the packed BWT from the input (the container
+	* [basepath].wg if container is true) and stores them to the cache. If load_wt
+	* is false the wavelet tree of L is neither loaded nor built, as needed by the
+	* interval stabbing algorithm; a cache built without it is rebuilt when it is needed.
+	*/
+	index_cache(std::string basepath, bool container, bool verb, bool load_wt = true)
+	{
+		std::string filepath = basepath + ".idx";
+		uint64_t fp = container ? fingerprint({basepath+".wg"})
+		                        : fingerprint({basepath+".L", basepath+".in", basepath+".out"});
+		if(load(filepath, basepath, fp, load_wt))
+		{
+			if(verb) std::cout << "Index loaded from " << filepath << std::endl;
+			return;
+		}
+		// build the index structures
+		{
+			wg_container wgc = container ? wg_container(basepath+".wg") : wg_container::from_triple(basepath);
+			fm_index = wfmi_t(wgc, basepath, load_wt);
+			stab = new interval_stabbing<wfmi_t>(wgc, &fm_index);
+		}
+		store(filepath, fp, load_wt);
+		if(verb) std::cout << "Index stored to " << filepath << std::endl;
+	}
+
+	index_cache(const index_cache&) = delete;
+	index_cache & operator= (const index_cache&) = delete;
+
+	~index_cache()
+	{
+		delete stab;
+		if(base != nullptr){ munmap(base, size); }
+	}
+
+	/* get the FM-index */
+	wfmi_t& get_fm_index(){ return fm_index; }
+	/* get the interval stabbing data structure */
+	interval_stabbing<wfmi_t>& get_interval_stabbing(){ return *stab; }
+
+private:
+	// FM-index
+	wfmi_t fm_index;
+	// interval stabbing data structure
+	interval_stabbing<wfmi_t>* stab = nullptr;
+	// mapped cache file
+	char* base = nullptr;
+	size_t size = 0;
+};
+
+}
+
+#endif /* INTERNAL_INDEX_CACHE_HPP_ */
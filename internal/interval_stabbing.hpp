@@ -2,11 +2,44 @@
 // Use of this source code is governed
 // by a MIT license that can be found in the LICENSE file.
 
+/*
+ *  interval_stabbing: bit-packed array simulating dynamic interval stabbing queries
+ *                     on the intervals between consecutive occurrences of a label
+ *                     in the BWT. The labels are remapped to the dense codes
+ *                     [0,sigma) of the effective alphabet and the BWT is split in
+ *                     blocks of width = max(64, sigma rounded up to 64) codes:
+ *
+ *      |header|left border|crossing -1|counts 0|block 0|stabbed 0|border 0|crossing 0|
+ *      |counts 1|block 1|...|border n-1|crossing n-1|crossing entries|
+ *
+ *  where border b has a bit per code crossing the right border of block b (border
+ *  b-1 is the left border of block b) and stabbed b a bit per position of block b
+ *  marking the interval starting there as stabbed; all bitvectors are width bits
+ *  stored in little-endian 64-bit words, least significant bit first.
+ *
+ *  Crossing b is a read-only copy of the initial border b followed by the 64-bit
+ *  index of its first crossing entry: the codes crossing border b have consecutive
+ *  entries, in code order, storing the distances of the ends of their interval from
+ *  the border in two 16-bit halves (0xFFFF if too far). The interval of a border
+ *  code is then read with one load next to the border instead of rank and select.
+ *
+ *  The array is self-contained: counts b stores for each code its 16-bit number of
+ *  occurrences between the start of the superblock of 2^16 positions containing
+ *  block b and the start of block b, and the header stores the alphabet, the
+ *  forward step base of each code, the code totals and the absolute counts at the
+ *  start of each superblock. Rank, select and forward steps on the BWT are then
+ *  answered from the block already in cache, without the wavelet tree of the
+ *  FM-index, which is only used to map BWT positions to nodes.
+ */
+
+//============================================================================
+
 #ifndef INTERNAL_INTERVAL_STABBING_HPP_
 #define INTERNAL_INTERVAL_STABBING_HPP_
 
 #include "common.hpp"
 #include "WG_string.hpp"
+#include "stabbing_kernels.hpp"
 
 // define birdges data type
 typedef std::pair<char_t,uint_t> bridge;
@@ -16,52 +49,284 @@ namespace wg{
 template<class wfmi_t>
 class interval_stabbing{
 
+public:
+	// index width
+	typedef typename wfmi_t::uint_type uint_t;
+	// FM-index of the Wheeler graph
+	typedef wfmi_t wfmi_type;
+	// stabbed interval: (character, right end)
+	typedef std::pair<char_t,uint_t> bridge;
+
+	/* scratch buffers of the block scans, one per thread in concurrent mode */
+	struct query_buffer{
+		// last position of each code before the query in its block
+		std::vector<int16_t> X;
+		// equality bitmasks of the block computed by the SIMD kernel
+		std::vector<uint64_t> masks;
+	};
+
 private:
-	// mask vector containing 128,64,32 ... in hex.
-	static constexpr unsigned char mask[] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
 	// check if s[i] == 1
-	inline bool bget(const char* s, uint i) { return ( (s[i/8]&mask[i%8]) ? 1 : 0 ); }
+	inline bool bget(const char* s, uint64_t i) { return (s[i/8] >> (i%8)) & 1; }
 	// set ith bit to 1
-	inline void bset(char* s, uint i) { s[(i)/8]=1 ? mask[(i)%8]|s[(i)/8] : (~mask[(i)%8])&s[(i)/8]; } 
+	inline void bset(char* s, uint64_t i) { s[i/8] |= char(1 << (i%8)); }
 	// set ith bit to 0
-	inline void bunset(char* s, uint i) { s[(i)/8]=0 ? mask[(i)%8]|s[(i)/8] : (~mask[(i)%8])&s[(i)/8]; } 
+	inline void bunset(char* s, uint64_t i) { s[i/8] &= char(~(1 << (i%8))); }
 	// compute ith BWT block offset in the packed BWT vector
-	uint_t compute_BWT_offset(uint_t i) { return (i*128 + i*32) + 16; }
-	// compute 8 bytes unsigned int from sequence of bytes
-	inline uint64_t get_8_uint(char* buf)
+	uint64_t compute_BWT_offset(uint64_t i) { return header_bytes + width/8 + i*record_bytes + xb_bytes + cnt_bytes; }
+	// compute the offset of the left border of the ith BWT block
+	uint64_t left_border_offset(uint64_t i) { return compute_BWT_offset(i) - cnt_bytes - xb_bytes - width/8; }
+	// compute the offset of the crossing data of the left border of the ith BWT block
+	uint64_t crossing_offset(uint64_t i) { return left_border_offset(i) + width/8; }
+	// read a 16-bit, 32-bit or 64-bit integer of the packed BWT at a given offset
+	inline uint64_t get_u16(uint64_t off){ uint16_t x; std::memcpy(&x, packed_BWT + off, sizeof(x)); return x; }
+	inline uint32_t get_u32(uint64_t off){ uint32_t x; std::memcpy(&x, packed_BWT + off, sizeof(x)); return x; }
+	inline uint64_t get_u64(uint64_t off){ uint64_t x; std::memcpy(&x, packed_BWT + off, sizeof(x)); return x; }
+	inline void set_u16(uint64_t off, uint16_t x){ std::memcpy(packed_BWT + off, &x, sizeof(x)); }
+	inline void set_u32(uint64_t off, uint32_t x){ std::memcpy(packed_BWT + off, &x, sizeof(x)); }
+	inline void set_u64(uint64_t off, uint64_t x){ std::memcpy(packed_BWT + off, &x, sizeof(x)); }
+	// index of the crossing entry of code cd, crossing the left border of the bth block
+	inline uint64_t crossing_index(uint64_t b, uint8_t cd)
 	{
-		return ((uint64_t)(((uint8_t *)(buf))[0])<<56) |
-		       ((uint64_t)(((uint8_t *)(buf))[1])<<48) |
-		       ((uint64_t)(((uint8_t *)(buf))[2])<<40) |
-		       ((uint64_t)(((uint8_t *)(buf))[3])<<32) |
-		       ((uint64_t)(((uint8_t *)(buf))[4])<<24) |
-		       ((uint64_t)(((uint8_t *)(buf))[5])<<16) |
-		       ((uint64_t)(((uint8_t *)(buf))[6])<<8) |
-		       ((uint64_t)(((uint8_t *)(buf))[7])<<0);
+		uint64_t off = crossing_offset(b), idx = get_u64(off + width/8);
+		for(uint64_t w=0;w<cd/64u;++w){ idx += __builtin_popcountll(get_u64(off + 8*w)); }
+		return idx + __builtin_popcountll(get_u64(off + 8*(cd/64)) & low_bits(cd%64));
 	}
-	// void print packet bwt()
-	void print_bwt()
+	// get the forward step base and the number of occurrences of code cd
+	inline uint64_t base(uint8_t cd){ return get_u64(base_off + 8*cd); }
+	inline uint64_t total(uint8_t cd){ return get_u64(totals_off + 8*cd); }
+	// get the number of occurrences of code cd before the sth superblock and the bth block
+	inline uint64_t super_sample(uint64_t s, uint8_t cd){ return get_u64(super_off + 8*(s*sigma + cd)); }
+	inline uint64_t sample(uint64_t b, uint8_t cd)
 	{
-		uint_t offset = 0;
-    	for(uint_t i=0;i<no_blocks;++i)
-    	{	
-    		for(uint_t j=0;j<128;++j)
-    			std::cout << bget(&packed_BWT[offset],j);
-    		offset += 16;
-    		std::cout << "|";
-    		for(uint_t j=0;j<128;++j)
-    			std::cout << packed_BWT[offset+j];
-    		std::cout << "|";
-    		offset += 128;
-    		for(uint_t j=0;j<128;++j)
-    			std::cout << bget(&packed_BWT[offset],j);
-    		offset += 16;
-    		std::cout << "|";
-    	}
-		for(uint_t j=0;j<128;++j){
-			std::cout << bget(&packed_BWT[offset],j);
+		return super_sample(b/bps, cd) + get_u16(compute_BWT_offset(b) - cnt_bytes + 2*cd);
+	}
+	// get the wth 64-bit word of a bitvector
+	inline uint64_t get_word(const char* s, uint64_t w)
+	{
+		if(concurrent)
+			return __atomic_load_n(reinterpret_cast<const uint64_t*>(s) + w, __ATOMIC_RELAXED);
+		uint64_t word; std::memcpy(&word, s + 8*w, sizeof(word));
+		return word;
+	}
+	/*
+	* set the ith bit to 1 and return its previous value; in concurrent mode the
+	* bit is set with an atomic or on its 64-bit word (the bitvectors start at
+	* multiples of 8 bytes from packed_BWT, which is at least 8-byte aligned)
+	*/
+	inline bool btest_set(char* s, uint64_t i)
+	{
+		if(concurrent)
+			return (__atomic_fetch_or(reinterpret_cast<uint64_t*>(s) + i/64, uint64_t(1) << (i%64), __ATOMIC_RELAXED) >> (i%64)) & 1;
+		bool b = bget(s,i); bset(s,i);
+		return b;
+	}
+	// set the ith bit to 0, atomically in concurrent mode
+	inline void bclear(char* s, uint64_t i)
+	{
+		if(concurrent)
+			__atomic_fetch_and(reinterpret_cast<uint64_t*>(s) + i/64, ~(uint64_t(1) << (i%64)), __ATOMIC_RELAXED);
+		else
+			bunset(s,i);
+	}
+
+	/* compute the codes of the labels and the sizes of the layout from the alphabet */
+	void init_layout()
+	{
+		std::fill(code, code+256, 0);
+		for(uint_t c=0;c<sigma;++c){ code[chars[c]] = c; }
+		// SIMD kernel of the block scan, used for the alphabets it is faster on
+		eq_masks = select_eq_masks_kernel(eq_masks_sigma);
+		// 16-bit counts of each block, padded to 8 bytes
+		cnt_bytes = ((2*sigma + 7)/8)*8;
+		// initial border and index of its first crossing entry
+		xb_bytes = width/8 + 8;
+		record_bytes = xb_bytes + cnt_bytes + width + 2*(width/8);
+		bps = (uint64_t(1) << 16) / width;
+		no_blocks = (this->size + width - 1) / width;
+		no_super = (no_blocks + bps - 1) / bps;
+		// header words: sigma, width, crossing entries, 256 bytes of labels, bases,
+		// totals, superblock counts
+		base_off = 8*(3 + 32);
+		totals_off = base_off + 8*sigma;
+		super_off = totals_off + 8*sigma;
+		header_bytes = super_off + 8*no_super*sigma;
+		// the crossing data of the last border closes the blocks
+		entries_off = header_bytes + width/8 + no_blocks*record_bytes + xb_bytes;
+		no_bytes = entries_off + 4*no_cross;
+	}
+
+	// get a 64-bit word with the k lowest bits set, k clamped to [0,64]
+	inline uint64_t low_bits(int64_t k) { return k <= 0 ? 0 : (k >= 64 ? ~uint64_t(0) : (uint64_t(1) << k) - 1); }
+
+	/*
+	* scan block b with the X array: push the intervals from the last occurrence
+	* of each code before offset to its first occurrence in [offset,len)
+	*/
+	void scan_block(uint64_t b, uint64_t offset, uint64_t len, uint64_t* both, std::vector<bridge>& res,
+	                query_buffer& qb)
+	{
+		uint64_t block_off = compute_BWT_offset(b);
+		const uint8_t* block = reinterpret_cast<const uint8_t*>(&packed_BWT[block_off]);
+		char* stabbed = &packed_BWT[block_off+width];
+		// clear X vector
+		std::vector<int16_t>& X = qb.X;
+		X.assign(sigma, -1);
+		// first scan in an internal block
+		for(uint64_t j=0;j<offset;++j)
+			X[block[j]] = j;
+		// second scan in an internal block
+		for(uint64_t j=offset;j<len;++j)
+		{
+			// if > -1 we have stabbed an interval
+			if(X[block[j]] > -1)
+			{
+				// check if interval has been already stabbed and set the corresponding bit to 1
+				if(!btest_set(stabbed,X[block[j]]))
+					// push an interval in the results
+					res.push_back(std::make_pair(chars[block[j]],b*width + j));
+				// set that we have already stabbed an interval for code block[j]
+				X[block[j]] = -2;
+				both[block[j]/64] |= uint64_t(1) << (block[j]%64);
+			} 
+		}
+	}
+
+	/*
+	* same as scan_block, reading the last and first occurrence of each code
+	* around offset from its equality bitmask computed by the SIMD kernel
+	*/
+	void scan_block_masks(uint64_t b, uint64_t offset, uint64_t len, uint64_t* both, std::vector<bridge>& res,
+	                      query_buffer& qb)
+	{
+		uint64_t block_off = compute_BWT_offset(b), words = width/64;
+		char* stabbed = &packed_BWT[block_off+width];
+		qb.masks.resize(sigma*words);
+		eq_masks(reinterpret_cast<const uint8_t*>(&packed_BWT[block_off]), words, sigma, qb.masks.data());
+		// positions before offset and in [offset,len) of each word
+		uint64_t pre[4], suf[4];
+		for(uint64_t w=0;w<words;++w)
+		{
+			pre[w] = low_bits(int64_t(offset) - int64_t(64*w));
+			suf[w] = low_bits(int64_t(len) - int64_t(64*w)) & ~pre[w];
+		}
+		for(uint64_t c=0;c<sigma;++c)
+		{
+			const uint64_t* m = &qb.masks[c*words];
+			int64_t last = -1, first = -1;
+			for(uint64_t w=0;w<words;++w)
+				if(m[w] & pre[w]){ last = 64*w + 63 - __builtin_clzll(m[w] & pre[w]); }
+			for(uint64_t w=0;w<words and first < 0;++w)
+				if(m[w] & suf[w]){ first = 64*w + __builtin_ctzll(m[w] & suf[w]); }
+			// c occurs on both sides: the interval (last,first] is stabbed
+			if(last > -1 and first > -1)
+			{
+				if(!btest_set(stabbed,last))
+					res.push_back(std::make_pair(chars[c],b*width + first));
+				both[c/64] |= uint64_t(1) << (c%64);
+			}
+		}
+	}
+
+	/* compute the bit-packed array interleaving BWT blocks and bitvectors */
+	void init_packed_BWT(const char* L, uint_t len)
+	{
+		this->size = len;
+		// compute the alphabet of L
+		std::vector<uint64_t> freq(256,0);
+		for(uint64_t i=0;i<size;++i){ freq[uint8_t(L[i])]++; }
+		for(uint64_t c=0;c<256;++c)
+			if(freq[c] > 0){ chars.push_back(c); }
+		sigma = chars.size();
+		width = std::max<uint64_t>(64, ((sigma+63)/64)*64);
+		// count the codes crossing each border, first[j] is the index of the first
+		// crossing entry of border j
+		uint64_t nb = (size + width - 1) / width;
+		std::vector<uint64_t> first(nb+1,0);
+		{
+			std::vector<int64_t> last_block(256,-1);
+			for(uint64_t i=0;i<size;++i)
+			{
+				uint8_t c = L[i]; int64_t b = i/width;
+				if(last_block[c] != -1)
+					for(int64_t j=last_block[c];j<b;++j){ first[j+1]++; }
+				last_block[c] = b;
+			}
 		}
-    	std::cout << std::endl;
+		for(uint64_t j=0;j<nb;++j){ first[j+1] += first[j]; }
+		no_cross = first[nb];
+		init_layout();
+    	// initialize packed BWT array with the header followed by the structure: |width bits|width bits|index|counts|width codes|width bits|
+    	// width bits for the bitvector storing the codes crossing the left border
+    	// width bits and the index of the first crossing entry of the left border
+    	// sigma 16-bit counts of the codes between the superblock and the block start
+    	// width bytes for storing a BWT block of width codes
+    	// width bits for the bitvector storing the stabbed intervals
+    	// width bits for the bitvector storing the codes crossing the right border
+    	// (new char[] is aligned to 16 bytes, as required by the atomic word updates)
+    	packed_BWT = new char[no_bytes+1];
+    	memset(packed_BWT,0,no_bytes+1);
+    	// write the header
+    	set_u64(0, sigma); set_u64(8, width); set_u64(16, no_cross);
+    	for(uint64_t c=0;c<sigma;++c)
+    	{
+    		packed_BWT[24+c] = chars[c];
+    		set_u64(base_off + 8*c, wfm_index->forward_base(chars[c]));
+    		set_u64(totals_off + 8*c, freq[chars[c]]);
+    	}
+    	
+    	uint64_t n=0;
+    	// occurrences of each code before position n and before the current superblock
+    	std::vector<uint64_t> occ(sigma,0), super_occ(sigma,0);
+    	std::vector<int64_t> last_occ(sigma,-1);
+    	// construct n/width blocks
+    	while(n < size){
+    		// init needed variables
+    		uint64_t b = n/width, block_idx = compute_BWT_offset(b);
+    		// write the rank samples of the block
+    		if(b % bps == 0)
+    		{
+    			super_occ = occ;
+    			for(uint64_t c=0;c<sigma;++c){ set_u64(super_off + 8*((b/bps)*sigma + c), occ[c]); }
+    		}
+    		for(uint64_t c=0;c<sigma;++c){ set_u16(block_idx - cnt_bytes + 2*c, occ[c] - super_occ[c]); }
+    		// iterate over all blocks of size width
+    		for(uint64_t i=0;i<std::min<uint64_t>(width,size-n);++i)
+	    	{
+	    		uint8_t curr = code[uint8_t(L[n+i])];
+	    		packed_BWT[block_idx++] = curr;
+	    		occ[curr]++;
+	    		// fill bitvectors storing crossing intervals
+	    		if(last_occ[curr] != -1)
+	    		{
+	    			// set bits for crossing intervals
+	    			for(uint64_t j=last_occ[curr];j<b;++j)
+	    				bset(&packed_BWT[compute_BWT_offset(j)+width+width/8],curr);
+	    		}
+	    		last_occ[curr] = b;
+	    	}
+	    	// go to the next block 
+	    	n += width;
+    	}
+    	// copy the initial borders and write the crossing entries
+    	for(uint64_t j=0;j<no_blocks;++j)
+    	{
+    		memcpy(&packed_BWT[crossing_offset(j+1)], &packed_BWT[left_border_offset(j+1)], width/8);
+    		set_u64(crossing_offset(j+1) + width/8, first[j]);
+    	}
+    	std::vector<int64_t> prev(sigma,-1);
+    	for(uint64_t p=0;p<size;++p)
+    	{
+    		uint8_t curr = code[uint8_t(L[p])];
+    		int64_t q = prev[curr];
+    		for(uint64_t j=q < 0 ? p/width : q/width;j<p/width;++j)
+    		{
+    			uint64_t bpos = (j+1)*width;
+    			uint64_t dl = std::min<uint64_t>(bpos - q, 0xFFFF), dr = std::min<uint64_t>(p - bpos, 0xFFFF);
+    			set_u32(entries_off + 4*crossing_index(j+1,curr), uint32_t(dl | (dr << 16)));
+    		}
+    		prev[curr] = p;
+    	}
 	}
 	
 public:
@@ -81,114 +346,133 @@ public:
 		std::ifstream bitstring(filepath);
 		// compute bitvector length
 		bitstring.seekg(0, std::ios::end);
-		this->size = bitstring.tellg();
+		std::string L(bitstring.tellg(),0);
     	bitstring.seekg(0, std::ios::beg);
-    	// compute number of blocks
-    	no_blocks = std::ceil(double(this->size)/sigma);
-    	no_bytes = (no_blocks * sigma) + (no_blocks * 2 * (sigma/8)) + (sigma/8);
-    	// initialize packed BWT array with the following structure: |16 bits|128 bits|16 bits|16 bits|
-    	// 16 bits for the bitvector storing the characters crossing the left border
-    	// 128 bits for storing a BWT block of 128 characters
-    	// 16 bits for the bitvector storing the stabbed intervals
-    	// 16 bits for the bitvector storing the characters crossing the right border
-    	packed_BWT = new char[no_bytes+1];
-    	X = new char[128]; 
-    	memset(packed_BWT,0,no_bytes+1); memset(X,0,128);
-    	
-    	uint_t n=0, cnt=0;
-    	std::vector<int> last_occ(sigma,-1);
-    	std::vector<bool> curr_block(sigma,0);
-    	// construct n/sigma blocks
-    	while(n < size){
-    		// increment block count
-    		cnt++;
-    		// reset current block
-    		std::fill(curr_block.begin(), curr_block.end(), 0);
-    		// init needed variables
-    		uint_t block_idx = compute_BWT_offset(n/128);
-    		// iterate over all blocks of size sigma
-    		for(uint_t i=0;i<std::min(sigma,size-n);++i)
-	    	{
-	    		char curr;
-	    		bitstring.read(reinterpret_cast<char*>(&curr), sizeof(char));
-	    		packed_BWT[block_idx++] = curr;
-	    		curr_block[curr] = 1;
-	    		// fill bitvectors storing crossing intervals
-	    		if(last_occ[curr] != -1)
-	    		{
-	    			if(last_occ[curr] != cnt)
-	    			{
-	    				// set bits for crossing intervals
-	    				for(uint_t j=last_occ[curr];j<cnt;++j)
-	    					bset(&packed_BWT[compute_BWT_offset(j-1)+128+16],curr);
-	    			}
-	    		}
-	    		last_occ[curr] = cnt;
-	    	}
-	    	// go to the next block 
-	    	n += sigma;
-    	}
+    	// read the BWT
+    	bitstring.read(&L[0], L.size());
     	// close input stream
     	bitstring.close();
+    	// build the packed BWT
+    	init_packed_BWT(L.data(), L.size());
+	}
+	/*
+	* Constructor that takes in input a bit-packed container and the FM-index
+	* of the Wheeler graph, reading the BWT from the container memory directly
+	*/
+	interval_stabbing(const wg_container& wgc, wfmi_t* i): wfm_index(i)
+	{
+		init_packed_BWT(reinterpret_cast<const char*>(wgc.get_L()), wgc.get_L_length());
 	}
 
-	int64_t check_interval_crossing_border(uint_t i, char_t c, sdsl::wt_huff<>& wt) // b|blo (b) cco|bordo
+	/*
+	* Constructor that takes in input a packed BWT computed by a previous
+	* run (see get_packed_BWT) and the FM-index of the Wheeler graph. The
+	* packed BWT is modified in place by the queries and is not freed.
+	*/
+	interval_stabbing(char* packed, uint_t len, wfmi_t* i): wfm_index(i), size(len)
 	{
-		////// std::cout << "i: " << i << " c: " << c << std::endl;
-		uint_t rank, left = 0, right = 0;
-		int64_t result = -1;
-		// compute left and right end of the interval
-		rank = wt.rank(i,c);
-		if(rank > 0)
+		packed_BWT = packed; owned = false;
+		// read the alphabet from the header
+		sigma = get_u64(0); width = get_u64(8); no_cross = get_u64(16);
+		for(uint64_t c=0;c<sigma;++c){ chars.push_back(packed_BWT[24+c]); }
+		init_layout();
+	}
+
+	interval_stabbing(const interval_stabbing&) = delete;
+	interval_stabbing & operator= (const interval_stabbing&) = delete;
+
+	~interval_stabbing()
+	{
+		if(owned){ delete[] packed_BWT; }
+	}
+
+	/* get the packed BWT array and its size in bytes */
+	const char* get_packed_BWT(){ return packed_BWT; }
+	uint64_t get_packed_BWT_bytes(){ return no_bytes+1; }
+	/* get the number of distinct labels and the block width */
+	uint_t get_sigma(){ return sigma; }
+	uint64_t get_width(){ return width; }
+
+	/* number of occurrences of code cd in the BWT prefix [0,i), from the rank samples */
+	uint64_t rank(uint64_t i, uint8_t cd)
+	{
+		if(i >= size){ return total(cd); }
+		uint64_t b = i/width, r = sample(b, cd);
+		const uint8_t* block = reinterpret_cast<const uint8_t*>(&packed_BWT[compute_BWT_offset(b)]);
+		for(uint64_t j=0;j<i%width;++j){ r += (block[j] == cd); }
+		return r;
+	}
+
+	/*
+	* position of the (r+1)th occurrence of code cd in the BWT, r < total(cd),
+	* galloping from the block hint over the rank samples: the occurrences around
+	* a query are found touching a number of blocks logarithmic in their distance
+	*/
+	uint64_t select(uint64_t r, uint8_t cd, uint64_t hint)
+	{
+		// find the blocks lo < hi with sample(lo) <= r < sample(hi)
+		uint64_t lo, hi, step = 1;
+		hint = std::min(hint, no_blocks-1);
+		if(sample(hint,cd) <= r)
 		{
-			left = wt.select(rank,c); right = wt.select(rank+1,c);
-			////// std::cout << "(" << left << ".." << right << ")\n";
-			// check if the interval intersects i and is not stabbed already
-			if((i > left and i <= right) and (!bget(&packed_BWT[compute_BWT_offset(left/128)+128],left)))
-			{
-				// set interval as stabbed
-				bset(&packed_BWT[compute_BWT_offset(left/128)+128],left);
-				// remove character from borders
-				for(uint_t j=left/128;j<right/128;++j)
-					bunset(&packed_BWT[compute_BWT_offset(j)+128+16],c);
-				// store result
-				result = right;
-			}
+			lo = hint;
+			while(lo + step < no_blocks and sample(lo+step,cd) <= r){ lo += step; step *= 2; }
+			hi = std::min(no_blocks, lo + step);
 		}
-
-		return result;
+		else
+		{
+			hi = hint;
+			while(hi >= step and sample(hi-step,cd) > r){ hi -= step; step *= 2; }
+			lo = hi >= step ? hi - step : 0;
+		}
+		// last block with at most r occurrences before it
+		while(hi - lo > 1){ uint64_t mid = (lo+hi)/2; if(sample(mid,cd) <= r) lo = mid; else hi = mid; }
+		// scan the block for the remaining occurrences
+		uint64_t k = r - sample(lo, cd);
+		const uint8_t* block = reinterpret_cast<const uint8_t*>(&packed_BWT[compute_BWT_offset(lo)]);
+		uint64_t j = 0;
+		for(;;++j)
+			if(block[j] == cd){ if(k == 0) break; k--; }
+		return lo*width + j;
 	}
 
-	/* check if we are stabbing some intervals crossing a border */
-	int64_t get_crossing_interval(uint_t i, char_t c, bool is_left_border)
+	/*
+	* check if we are stabbing the interval of code cd crossing the left (or right)
+	* border of the block of i; its ends are read from the crossing entry of the
+	* border, or found with rank and select if they are too far from it
+	*/
+	int64_t get_crossing_interval(uint_t i, uint8_t cd, bool is_left_border)
 	{
-		uint_t rank, left = 0, right = 0;
+		uint64_t left = 0, right = 0;
 		int64_t result = -1;
 		// compute left and right end of the interval
-		rank = wfm_index->rank_wt(i,c);
-		//std::cout << "rank= " << rank << std::endl;
-		if(rank > 0 and rank < wfm_index->char_occs_bwt(c))
+		uint64_t bd = i/width + (is_left_border ? 0 : 1);
+		uint32_t e = get_u32(entries_off + 4*crossing_index(bd,cd));
+		if((e & 0xFFFF) != 0xFFFF and (e >> 16) != 0xFFFF)
+		{
+			left = bd*width - (e & 0xFFFF); right = bd*width + (e >> 16);
+		}
+		else
+		{
+			// use the rank samples to get the closest left and right occurrences
+			uint64_t rk = rank(i,cd);
+			if(rk > 0 and rk < total(cd)){ left = select(rk-1,cd,i/width); right = select(rk,cd,i/width); }
+		}
+		if(right > 0)
 		{
-			// use the BWT wavelet tree to get the closest left and right occurrences
-			left = wfm_index->select_wt(rank-1,c); right = wfm_index->select_wt(rank,c);
-			// std::cout << "(" << left << ".." << right << "]" << std::endl;
-			// std::cout << "(" << left - ((left/128)*128) << ".." << right - ((right/128)*128) << "]" << std::endl;
 			// compute the offset in the block
-			uint_t block_offset = left - ((left/128)*128);
-			// get bool marking if (left,right] has been already stabbed
-			bool_t stabbed = bget(&packed_BWT[compute_BWT_offset(left/128)+128],block_offset);
-			// return the interval (left,right] if it is the first time it gets stabbed.
-			if((i > left and i <= right) and (not stabbed))
+			uint64_t block_offset = left % width;
+			// return the interval (left,right] if it is the first time it gets stabbed,
+			// setting it as stabbed
+			if((i > left and i <= right) and
+			   not btest_set(&packed_BWT[compute_BWT_offset(left/width)+width],block_offset))
 			{
-				// set interval as stabbed
-				bset(&packed_BWT[compute_BWT_offset(left/128)+128],block_offset);
 				// remove character from borders
-				for(uint_t j=left/128;j<right/128;++j)
-					bunset(&packed_BWT[compute_BWT_offset(j)+128+16],c);
+				for(uint64_t j=left/width;j<right/width;++j)
+					bclear(&packed_BWT[compute_BWT_offset(j)+width+width/8],cd);
 				// store result
 				result = right;
 			}
-			//}
 		}
 		return result;
 	}
@@ -196,122 +480,108 @@ public:
 	/* compute an interval stabbing query */
 	std::vector<bridge> interval_stab_query(uint_t i)
 	{
-		// prefetch needed memory locations
-		__builtin_prefetch(X);
-		// clear X vector
-		std::memset(X,-1,128);
+		std::vector<bridge> res;
+		interval_stab_query(i, res);
+
+		return res;
+	}
+
+	/* compute an interval stabbing query, writing the stabbed bridges in the
+	   caller-owned vector res, which is cleared first and keeps its capacity */
+	void interval_stab_query(uint_t i, std::vector<bridge>& res)
+	{
+		interval_stab_query(i, res, qbuf);
+	}
+
+	/* compute an interval stabbing query with the caller-owned scratch buffers qb;
+	   in concurrent mode, queries with distinct buffers can run in parallel */
+	void interval_stab_query(uint_t i, std::vector<bridge>& res, query_buffer& qb)
+	{
 		// identify block
-		uint_t b = i/128, offset, block_off;
-		offset =  i - (b*128);
+		uint64_t b = i/width, offset, block_off;
+		offset =  i - (b*width);
 		block_off = compute_BWT_offset(b);
 		// prefetch needed memory locations
-		__builtin_prefetch(&packed_BWT[block_off-16]);
+		__builtin_prefetch(&packed_BWT[left_border_offset(b)]);
+		// the last block can be shorter than width
+		uint64_t len = std::min<uint64_t>(width, size - b*width);
+		// codes occurring both before and after the query in the block
+		uint64_t both[4] = {0,0,0,0};
 
-		std::vector<bridge> res;
-		// first scan in an internal block
-		for(uint_t j=0;j<offset;++j)
-			X[packed_BWT[block_off + j]] = j;
-		// second scan in an internal block
-		for(uint_t j=offset;j<128;++j)
+		res.clear();
+		if(eq_masks != nullptr and sigma <= eq_masks_sigma)
+			scan_block_masks(b, offset, len, both, res, qb);
+		else
+			scan_block(b, offset, len, both, res, qb);
+		// scan the left and right borders, one bit per code
+		for(int k=0;k<2;++k)
 		{
-			// if > -1 we have stabbed an interval
-			if(X[packed_BWT[block_off + j]] > -1)
-			{
-				// check if interval has been already stabbed
-				if(!bget(&packed_BWT[block_off+128],X[packed_BWT[block_off + j]]))
+			const char* border = &packed_BWT[k == 0 ? left_border_offset(b) : block_off+width+width/8];
+			for(uint64_t w=0;w<width/64;++w)
+				// check characters in the border only if we do not have already
+				// stabbed an interval of the same character in the block
+				for(uint64_t word = get_word(border,w) & ~both[w]; word != 0; word &= word-1)
 				{
-					// push an interval in the results and the set corresponding bit to 1
-					res.push_back(std::make_pair(packed_BWT[block_off + j],b*128 + j));
-					bset(&packed_BWT[block_off+128],X[packed_BWT[block_off + j]]);
+					uint64_t pos = 64*w + __builtin_ctzll(word);
+					int64_t r = get_crossing_interval(i,pos,k == 0);
+					if(r > -1){ res.push_back(std::make_pair(chars[pos],(uint64_t)r)); }
 				}
-				// set that we have already stabbed an interval for character X[packed_BWT[block_off + j]]
-				X[packed_BWT[block_off + j]] = -2;
-			} 
 		}
-		// scan first left-word
-		uint64_t word = get_8_uint(&packed_BWT[block_off-16]);
-		if(word != 0)
-			for(uint_t j=0;j<64;++j)
-			{
-				uint_t pos;
-				if(bget(&packed_BWT[block_off-16],j))
-				{
-					pos = j;
-					// check character in the border only if we do not have already
-					// stabbed an interval of the same character 
-					if(X[pos] != -2)
-					{
-						int64_t b =  get_crossing_interval(i,pos,true);
-						if(b > -1){ res.push_back(std::make_pair(pos,(uint64_t)b)); }
-					}
-				}
-			}
-		// scan second left-word
-		word = get_8_uint(&packed_BWT[block_off-8]);
-		if(word != 0)
-			for(uint_t j=0;j<64;++j)
-			{
-				uint_t pos;
-				if(bget(&packed_BWT[block_off-8],j))
-				{
-					pos = 64 + j;
-					// check character in the border only if we do not have already
-					// stabbed an interval of the same character 
-					if(X[pos] != -2)
-					{
-						int64_t b =  get_crossing_interval(i,pos,true);
-						if(b > -1){ res.push_back(std::make_pair(pos,(uint64_t)b)); }
-					}
-				}
-			}
-		// scan right border
-		word = get_8_uint(&packed_BWT[block_off+144]);
-		if(word != 0)
-			for(uint_t j=0;j<64;++j)
-			{
-				uint_t pos;
-				if(bget(&packed_BWT[block_off+144],j))
-				{
-					pos = j;
-					// check character in the border only if we do not have already
-					// stabbed an interval of the same character 
-					if(X[pos] != -2)
-					{
-						int64_t b =  get_crossing_interval(i,pos,false);
-						if(b > -1){ res.push_back(std::make_pair(pos,(uint64_t)b)); }
-					}
-				}
-			}
-		//
-		word = get_8_uint(&packed_BWT[block_off+152]);
-		if(word != 0)
-			for(uint_t j=0;j<64;++j)
+	}
+
+	/*
+	* switch the concurrent mode, where the stabbed and border bits are updated
+	* with atomic operations so that concurrent queries stab each interval once
+	*/
+	void set_concurrent(bool c){ concurrent = c; }
+
+	/* compute forward search step for position j, L[j] = c */
+	uint_t forward(uint_t j, char_t c)
+	{
+		return base(code[c]) + rank(j, code[c]);
+	}
+
+	/* position of a left to right scan of the packed BWT and occurrences of each code before it */
+	struct sweep_state{
+		uint64_t pos = 0;
+		std::vector<uint64_t> cnt;
+	};
+	/* reset a scan to the start of the BWT */
+	void reset_sweep(sweep_state& st){ st.pos = 0; st.cnt.assign(sigma, 0); }
+
+	/*
+	* compute the forward search step of all the (character, position) pairs in
+	* occs, sorted by position, scanning the packed BWT left to right from the
+	* position of the sweep state and jumping to the rank samples of the blocks
+	* it skips; res[x] is forward(occs[x].second, occs[x].first)
+	*/
+	void forward_sweep(const std::vector<bridge>& occs, std::vector<uint_t>& res, sweep_state& st)
+	{
+		res.resize(occs.size());
+		for(uint64_t x=0;x<occs.size();++x)
+		{
+			uint64_t p = occs[x].second; uint8_t cd = code[occs[x].first];
+			if( p < st.pos ){ res[x] = forward(p, occs[x].first); continue; }
+			// jump to the block of p
+			uint64_t b = p/width;
+			if( b > st.pos/width )
 			{
-				uint_t pos;
-				if(bget(&packed_BWT[block_off+152],j))
-				{
-					pos = 64 + j;
-					// check character in the border only if we do not have already
-					// stabbed an interval of the same character 
-					if(X[pos] != -2)
-					{
-						int64_t b =  get_crossing_interval(i,pos,false);
-						if(b > -1){ res.push_back(std::make_pair(pos,(uint64_t)b)); }
-					}
-				}
+				st.pos = b*width;
+				for(uint64_t c=0;c<sigma;++c){ st.cnt[c] = sample(b, c); }
 			}
-
-		return res;
+			const uint8_t* block = reinterpret_cast<const uint8_t*>(&packed_BWT[compute_BWT_offset(b)]);
+			for(;st.pos<p;++st.pos){ st.cnt[block[st.pos - b*width]]++; }
+			res[x] = base(cd) + st.cnt[cd];
+		}
 	}
 
 	/* get LCP entries containing a zero value */
 	std::vector<uint_t> get_0_entries()
 	{
 		std::vector<uint_t> res;
-		std::vector<bridge> occs = wfm_index->first_char_occs();
-		// forward each position
-		for(uint_t i=0;i<occs.size();++i)
-			res.push_back(wfm_index->forward(occs[i].second,occs[i].first));
+		// the forward step of the first occurrence of each code is its base
+		for(uint64_t c=0;c<sigma;++c)
+			res.push_back(base(c));
 
 		return res;
 	}
@@ -336,17 +606,35 @@ public:
 
 private:
 	// array packing BWT blocks + bitvectors
-	char* packed_BWT;
-	// ausiliary array
-	char* X;
+	char* packed_BWT = nullptr;
+	// true if packed_BWT was allocated by this object
+	bool owned = true;
+	// scratch buffers of the single-threaded queries
+	query_buffer qbuf;
+	// SIMD kernel computing the equality bitmasks of a block and the largest
+	// alphabet it is used for
+	eq_masks_kernel eq_masks = nullptr;
+	uint64_t eq_masks_sigma = 0;
+	// true if the bits are updated with atomic operations
+	bool concurrent = false;
 	// size 
 	uint_t size;
-	// no blocks
-	uint_t no_blocks, no_bytes;
-	// alphabet size
-	const uint_t sigma = 128;
+	// no blocks, superblocks and bytes
+	uint64_t no_blocks, no_super, no_bytes;
+	// blocks per superblock, bytes of the initial border, of the counts of a block
+	// and of a block record
+	uint64_t bps, xb_bytes, cnt_bytes, record_bytes;
+	// offsets of the header fields, size of the header, offset and number of the
+	// crossing entries
+	uint64_t base_off, totals_off, super_off, header_bytes, entries_off, no_cross = 0;
+	// alphabet size, labels of the codes and codes of the labels
+	uint_t sigma;
+	std::vector<char_t> chars;
+	uint8_t code[256];
+	// block width, i.e. codes per block and bits per bitvector
+	uint64_t width;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
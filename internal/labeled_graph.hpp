@@ -0,0 +1,190 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  labeled_graph: edge-labeled graph read from a .dot file and pseudoforest
+ *                 writer producing the .L/.in/.out (+ .dot) encoding.
+ *                 This header does not depend on sdsl.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_LABELED_GRAPH_HPP_
+#define INTERNAL_LABELED_GRAPH_HPP_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+namespace pr{
+
+#ifndef M64
+	#define M64 0
+#endif
+
+#if M64
+	typedef uint64_t node_t;
+	#define NO_NODE UINT64_MAX
+#else
+	typedef uint32_t node_t;
+	#define NO_NODE UINT32_MAX
+#endif
+typedef uint8_t label_t;
+
+/* edge-labeled graph stored as a list of (origin, destination, label) triples */
+struct labeled_graph{
+	// number of nodes
+	node_t n = 0;
+	// edges
+	std::vector<node_t> origin, dest;
+	std::vector<label_t> label;
+
+	/* return number of edges */
+	uint64_t no_edges() const { return label.size(); }
+};
+
+/* parse a dot file where each edge line has the form: S<i> -> S<j> [ label = <c> ]; */
+labeled_graph read_dot(std::string filepath)
+{
+	labeled_graph G;
+	// open stream to input
+	FILE* input = std::fopen(filepath.c_str(), "r");
+	if(input == nullptr)
+	{
+		std::cerr << "Error! cannot open the .dot file." << std::endl;
+		exit(1);
+	}
+	// read the whole file
+	std::string buf;
+	std::fseek(input, 0, SEEK_END); buf.resize(std::ftell(input)); std::fseek(input, 0, SEEK_SET);
+	if(fread(&buf[0], 1, buf.size(), input) != buf.size())
+	{
+		std::cerr << "Error! cannot read the .dot file." << std::endl;
+		exit(1);
+	}
+	std::fclose(input);
+
+	// read an unsigned integer starting at position i
+	auto read_uint = [&](size_t& i){
+		uint64_t x = 0;
+		while(i < buf.size() && buf[i] >= '0' && buf[i] <= '9'){ x = x*10 + (buf[i++]-'0'); }
+		return x;
+	};
+	// skip blanks starting at position i
+	auto skip_blanks = [&](size_t& i){ while(i < buf.size() && (buf[i] == ' ' || buf[i] == '\t')){ i++; } };
+
+	size_t i = 0;
+	while(i < buf.size())
+	{
+		size_t eol = buf.find('\n', i);
+		if(eol == std::string::npos){ eol = buf.size(); }
+		// skip lines not encoding an edge in the dot file
+		size_t arrow = i;
+		while(arrow+1 < eol && !(buf[arrow] == '-' && buf[arrow+1] == '>')){ arrow++; }
+		if(arrow+1 < eol)
+		{
+			// read an edge in the dot file, ids are 1-based
+			skip_blanks(i); i++;
+			node_t o = read_uint(i) - 1;
+			i = arrow + 2; skip_blanks(i); i++;
+			node_t d = read_uint(i) - 1;
+			i = buf.find('=', i) + 1; skip_blanks(i);
+			uint64_t c = read_uint(i);
+			if(c < 1 || c > 255)
+			{
+				std::cerr << "Error! edge labels must be in [1,255]." << std::endl;
+				exit(1);
+			}
+			// add edge
+			G.origin.push_back(o); G.dest.push_back(d); G.label.push_back(c);
+			G.n = std::max(G.n, std::max(o, d) + 1);
+		}
+		i = eol + 1;
+	}
+
+	if(G.no_edges() == 0)
+	{
+		std::cerr << "Error! the .dot file does not contain any edge." << std::endl;
+		exit(1);
+	}
+
+	return G;
+}
+
+/*
+ * Pseudoforest whose nodes are listed in co-lex order of their incoming strings:
+ * every node is either a source (pred == NO_NODE) or is reached by exactly one
+ * edge labeled label[i] from pred[i].
+ */
+struct pseudoforest{
+	// predecessor of each node
+	std::vector<node_t> pred;
+	// label of the incoming edge of each node
+	std::vector<label_t> label;
+
+	/* return number of nodes */
+	node_t size() const { return pred.size(); }
+
+	/* write the .L/.in/.out encoding and the .dot file of the pseudoforest */
+	void write(std::string basepath) const
+	{
+		node_t n = size();
+		// count out-degrees; children are visited in node order, i.e. sorted by label
+		std::vector<uint64_t> first(n+1,0);
+		for(node_t i=0;i<n;++i)
+			if(pred[i] != NO_NODE){ first[pred[i]+1]++; }
+		for(node_t i=0;i<n;++i)
+			first[i+1] += first[i];
+		std::vector<node_t> child(first[n]);
+		{
+			std::vector<uint64_t> next(first.begin(),first.end()-1);
+			for(node_t i=0;i<n;++i)
+				if(pred[i] != NO_NODE){ child[next[pred[i]]++] = i; }
+		}
+
+		buffered_file L(basepath+".L"), out(basepath+".out"), in(basepath+".in"), dot(basepath);
+		dot.put("strict digraph {\n");
+		for(node_t i=0;i<n;++i)
+		{
+			// out-degree in unary followed by the outgoing labels
+			for(uint64_t j=first[i];j<first[i+1];++j)
+			{
+				out.put('0'); L.put(label[child[j]]);
+				dot.put("\tS" + std::to_string(i+1) + " -> S" + std::to_string(child[j]+1) +
+				        " [ label = " + std::to_string(label[child[j]]) + " ];\n");
+			}
+			out.put('1');
+			// in-degree in unary
+			if(pred[i] != NO_NODE){ in.put('0'); }
+			in.put('1');
+		}
+		dot.put("}\n");
+	}
+
+private:
+	/* minimal buffered writer */
+	class buffered_file{
+	public:
+		buffered_file(std::string path){
+			f = std::fopen(path.c_str(), "w");
+			if(f == nullptr){ std::cerr << "Error! cannot open " << path << std::endl; exit(1); }
+			buf.reserve(cap);
+		}
+		~buffered_file(){ flush(); std::fclose(f); }
+		void put(char c){ buf.push_back(c); if(buf.size() >= cap){ flush(); } }
+		void put(const std::string& s){ buf.append(s); if(buf.size() >= cap){ flush(); } }
+	private:
+		void flush(){ fwrite(buf.data(), 1, buf.size(), f); buf.clear(); }
+		static constexpr size_t cap = 1 << 20;
+		std::string buf;
+		FILE* f;
+	};
+};
+
+}
+
+#endif /* INTERNAL_LABELED_GRAPH_HPP_ */
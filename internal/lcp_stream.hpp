@@ -0,0 +1,74 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  lcp_stream: buffer passing the final LCP entries to a consumer as soon as they
+ *              are computed. The level-synchronous algorithms push the (position,
+ *              LCP value) entries of a level while they fill it and flush the
+ *              buffer at the end of the level, so the consumer receives the small
+ *              LCP values first, in batches of at most capacity entries, while
+ *              the higher levels are still being computed. Every position with a
+ *              finite LCP value is pushed exactly once; the positions never pushed
+ *              have an infinite LCP value. This header does not depend on sdsl.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_LCP_STREAM_HPP_
+#define INTERNAL_LCP_STREAM_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <functional>
+#include <cstdint>
+
+namespace wg{
+
+// (position, LCP value) entry
+typedef std::pair<uint64_t,uint64_t> lcp_entry;
+// consumer of a batch of final LCP entries
+typedef std::function<void(const lcp_entry*, uint64_t)> lcp_sink;
+
+class lcp_stream{
+
+public:
+	/*
+	* Constructor that takes in input the consumer of the batches and the
+	* maximum number of buffered entries
+	*/
+	lcp_stream(lcp_sink sink_, uint64_t capacity_ = (1 << 16)): sink(sink_), capacity(std::max<uint64_t>(capacity_,1))
+	{
+		buffer.reserve(capacity);
+	}
+
+	lcp_stream(const lcp_stream&) = delete;
+	lcp_stream & operator= (const lcp_stream&) = delete;
+
+	/* push the final value of LCP[i] */
+	void push(uint64_t i, uint64_t val)
+	{
+		buffer.push_back(std::make_pair(i,val));
+		if(buffer.size() >= capacity){ flush(); }
+	}
+
+	/* pass the buffered entries to the consumer */
+	void flush()
+	{
+		if(buffer.empty()){ return; }
+		sink(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+
+private:
+	// consumer of the batches
+	lcp_sink sink;
+	// buffered entries and maximum number of buffered entries
+	std::vector<lcp_entry> buffer;
+	uint64_t capacity;
+};
+
+}
+
+#endif /* INTERNAL_LCP_STREAM_HPP_ */
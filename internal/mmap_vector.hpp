@@ -0,0 +1,131 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  mmap_vector: fixed-size vector backed by a file mapped in memory with mmap.
+ *               The file holds the raw entries, so once the vector is filled
+ *               the file is already the output and no final write is needed;
+ *               the page cache writes the entries back to disk as needed.
+ *               This header does not depend on sdsl.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_MMAP_VECTOR_HPP_
+#define INTERNAL_MMAP_VECTOR_HPP_
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace wg{
+
+template<class T>
+class mmap_vector{
+
+public:
+	// types of the entries, of their references and of the sizes
+	typedef T value_type;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef uint64_t size_type;
+
+	// empty constructor
+	mmap_vector(){}
+	/*
+	* Constructor that creates (or truncates) the file filepath with n entries
+	* and maps it in memory, setting all entries to val
+	*/
+	mmap_vector(std::string filepath, uint64_t n_, T val){ open(filepath, n_, val); }
+	/*
+	* Constructor that maps in memory an existing file of raw entries
+	*/
+	mmap_vector(std::string filepath){ map(filepath); }
+
+	mmap_vector(const mmap_vector&) = delete;
+	mmap_vector & operator= (const mmap_vector&) = delete;
+
+	mmap_vector(mmap_vector&& other){ *this = std::move(other); }
+	mmap_vector & operator= (mmap_vector&& other)
+	{
+		close();
+		std::swap(v, other.v); std::swap(n, other.n);
+		return *this;
+	}
+
+	~mmap_vector(){ close(); }
+
+	/* create the file and map it in memory */
+	void open(std::string filepath, uint64_t n_, T val)
+	{
+		close();
+		n = n_;
+		int fd = ::open(filepath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0 or ftruncate(fd, n*sizeof(T)) != 0)
+		{
+			std::cerr << "Error! cannot create " << filepath << ", exiting...\n";
+			exit(1);
+		}
+		if(n > 0)
+		{
+			void* addr = mmap(nullptr, n*sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if(addr == MAP_FAILED){ std::cerr << "Error! cannot map " << filepath << ", exiting...\n"; exit(1); }
+			v = static_cast<T*>(addr);
+		}
+		::close(fd);
+		std::fill(v, v+n, val);
+	}
+
+	/* map an existing file in memory */
+	void map(std::string filepath)
+	{
+		close();
+		int fd = ::open(filepath.c_str(), O_RDWR);
+		if(fd < 0){ std::cerr << "Error! cannot open " << filepath << ", exiting...\n"; exit(1); }
+		struct stat st; fstat(fd, &st);
+		n = st.st_size / sizeof(T);
+		if(n > 0)
+		{
+			void* addr = mmap(nullptr, n*sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if(addr == MAP_FAILED){ std::cerr << "Error! cannot map " << filepath << ", exiting...\n"; exit(1); }
+			v = static_cast<T*>(addr);
+		}
+		::close(fd);
+	}
+
+	/* unmap the file, the entries are written back by the kernel */
+	void close()
+	{
+		if(v != nullptr){ munmap(v, n*sizeof(T)); }
+		v = nullptr; n = 0;
+	}
+
+	/* get number of entries */
+	uint64_t size() const { return n; }
+
+	/* get pointer to the entries */
+	T* data(){ return v; }
+	const T* data() const { return v; }
+
+	/* access ith entry */
+	T& operator[](uint64_t i){ return v[i]; }
+	const T& operator[](uint64_t i) const { return v[i]; }
+
+private:
+	// mapped entries
+	T* v = nullptr;
+	// number of entries
+	uint64_t n = 0;
+};
+
+}
+
+#endif /* INTERNAL_MMAP_VECTOR_HPP_ */
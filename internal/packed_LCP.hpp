@@ -0,0 +1,170 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  packed_LCP: block-wise bit-packed LCP file with O(1) random access. The LCP
+ *              is split in blocks of 64 entries, and each block stores its
+ *              entries with the minimum width w such that 2^w - 1 is larger
+ *              than every finite value of the block; the code 2^w - 1 is the
+ *              INF escape. The file layout is (64-bit little-endian words):
+ *
+ *      header: magic, version, no. entries, INF value, no. blocks
+ *      blocks: one word per block, (bit offset of the block << 8) | width
+ *      data:   packed entries, bit i stored in word i/64 at position i%64
+ *
+ *  write_packed_LCP writes the file from any random-access LCP vector, and
+ *  packed_LCP maps it in memory and decodes single entries. This header does
+ *  not depend on sdsl.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_PACKED_LCP_HPP_
+#define INTERNAL_PACKED_LCP_HPP_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace wg{
+
+/* header of the packed LCP file */
+struct packed_LCP_header{
+	uint64_t magic;
+	uint64_t version;
+	uint64_t size;
+	uint64_t inf;
+	uint64_t no_blocks;
+};
+
+// "WGLCP001" in little-endian
+constexpr uint64_t PACKED_LCP_MAGIC = 0x31303050434c4757ULL;
+constexpr uint64_t PACKED_LCP_VERSION = 1;
+// number of entries per block
+constexpr uint64_t PACKED_LCP_BLOCK = 64;
+
+/*
+ * Write the n entries of LCP to a packed LCP file, the entries equal to inf are
+ * stored with the escape code of their block.
+ */
+template<class vec_t>
+void write_packed_LCP(const std::string ofile_path, const vec_t& LCP, uint64_t n, uint64_t inf)
+{
+	packed_LCP_header h;
+	h.magic = PACKED_LCP_MAGIC; h.version = PACKED_LCP_VERSION;
+	h.size = n; h.inf = inf; h.no_blocks = (n + PACKED_LCP_BLOCK - 1) / PACKED_LCP_BLOCK;
+	std::vector<uint64_t> blocks(h.no_blocks), data;
+	uint64_t offset = 0;
+	for(uint64_t b=0;b<h.no_blocks;++b)
+	{
+		uint64_t first = b*PACKED_LCP_BLOCK, last = std::min(n, first + PACKED_LCP_BLOCK);
+		// compute the block width, the escape code must be larger than all values
+		uint64_t max = 0;
+		for(uint64_t i=first;i<last;++i)
+			if(uint64_t(LCP[i]) != inf){ max = std::max(max, uint64_t(LCP[i])); }
+		uint64_t w = 1;
+		while(w < 64 and max + 1 >= (uint64_t(1) << w)){ w++; }
+		uint64_t escape = (w == 64) ? UINT64_MAX : (uint64_t(1) << w) - 1;
+		blocks[b] = (offset << 8) | w;
+		// append the packed entries
+		data.resize((offset + (last-first)*w + 63) / 64, 0);
+		for(uint64_t i=first;i<last;++i,offset+=w)
+		{
+			uint64_t x = (uint64_t(LCP[i]) == inf) ? escape : uint64_t(LCP[i]);
+			data[offset/64] |= x << (offset%64);
+			if(offset%64 + w > 64){ data[offset/64 + 1] |= x >> (64 - offset%64); }
+		}
+	}
+	// write header, blocks and data
+	FILE * ofile = std::fopen(ofile_path.c_str(), "w");
+	if(ofile == nullptr){ std::cerr << "Error! cannot open " << ofile_path << ", exiting...\n"; exit(1); }
+	fwrite(&h, sizeof(h), 1, ofile);
+	fwrite(blocks.data(), sizeof(uint64_t), blocks.size(), ofile);
+	fwrite(data.data(), sizeof(uint64_t), data.size(), ofile);
+	fclose(ofile);
+}
+
+/* read-only memory-mapped packed LCP file with O(1) access to the entries */
+class packed_LCP{
+
+public:
+	/*
+	* Constructor that maps in memory a file written by write_packed_LCP
+	*/
+	packed_LCP(std::string filepath)
+	{
+		int fd = open(filepath.c_str(), O_RDONLY);
+		if(fd < 0){ std::cerr << "Error! cannot open " << filepath << ", exiting...\n"; exit(1); }
+		struct stat st; fstat(fd, &st);
+		size = st.st_size;
+		if(size < sizeof(packed_LCP_header)){ std::cerr << "Error! " << filepath << " is not a packed LCP file, exiting...\n"; exit(1); }
+		base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if(base == MAP_FAILED){ std::cerr << "Error! cannot map " << filepath << ", exiting...\n"; exit(1); }
+		header = reinterpret_cast<const packed_LCP_header*>(base);
+		if(header->magic != PACKED_LCP_MAGIC or header->version != PACKED_LCP_VERSION or
+		   size < sizeof(packed_LCP_header) + header->no_blocks*sizeof(uint64_t))
+		{
+			std::cerr << "Error! " << filepath << " is not a packed LCP file, exiting...\n";
+			exit(1);
+		}
+		blocks = reinterpret_cast<const uint64_t*>(header + 1);
+		data = blocks + header->no_blocks;
+	}
+
+	packed_LCP(const packed_LCP&) = delete;
+	packed_LCP & operator= (const packed_LCP&) = delete;
+
+	~packed_LCP(){ munmap(base, size); }
+
+	/* get number of entries */
+	uint64_t get_size() const { return header->size; }
+	/* get value used for infinite entries */
+	uint64_t get_inf() const { return header->inf; }
+
+	/* get ith LCP entry */
+	uint64_t operator[](uint64_t i) const
+	{
+		uint64_t b = blocks[i / PACKED_LCP_BLOCK], w = b & 0xff;
+		uint64_t offset = (b >> 8) + (i % PACKED_LCP_BLOCK) * w;
+		uint64_t escape = (w == 64) ? UINT64_MAX : (uint64_t(1) << w) - 1;
+		// read w bits starting at offset, possibly spanning two words
+		uint64_t x = data[offset/64] >> (offset%64);
+		if(offset%64 + w > 64){ x |= data[offset/64 + 1] << (64 - offset%64); }
+		x &= escape;
+
+		return (x == escape) ? header->inf : x;
+	}
+
+	/* decode the whole LCP vector */
+	std::vector<uint64_t> decode() const
+	{
+		std::vector<uint64_t> LCP(get_size());
+		for(uint64_t i=0;i<LCP.size();++i)
+			LCP[i] = (*this)[i];
+
+		return LCP;
+	}
+
+private:
+	// mapped memory
+	void* base = nullptr;
+	size_t size = 0;
+	// file header, block descriptors and packed entries
+	const packed_LCP_header* header = nullptr;
+	const uint64_t* blocks = nullptr;
+	const uint64_t* data = nullptr;
+};
+
+}
+
+#endif /* INTERNAL_PACKED_LCP_HPP_ */
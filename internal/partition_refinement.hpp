@@ -0,0 +1,332 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  partition_refinement: ordered partition refinement computing the co-lex order
+ *  of the infimum (or supremum) strings of a labeled graph, and the deterministic
+ *  Wheeler pseudoforest G_is obtained by pruning and merging the two orders.
+ *
+ *  Every node u is first restricted to its in-edges of minimum (maximum) label
+ *  lambda(u), so that inf(u) = min{ inf(v) : v pred of u } . lambda(u). Starting from
+ *  the partition by lambda, each block is split until all of its nodes have their
+ *  leftmost (rightmost) predecessor in the same block. When a block is split, only
+ *  the out-edges of the parts other than the largest one are scanned (Hopcroft's
+ *  trick), hence each edge is scanned O(log n) times.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_PARTITION_REFINEMENT_HPP_
+#define INTERNAL_PARTITION_REFINEMENT_HPP_
+
+#include <algorithm>
+#include <thread>
+
+#include "labeled_graph.hpp"
+
+namespace pr{
+
+class partition_refinement{
+
+private:
+	/* add node u to the touched list of its block */
+	void touch(node_t u)
+	{
+		if( touched[u] ){ return; }
+		touched[u] = true;
+		node_t B = block_of[u];
+		if( touched_list[B].empty() ){ dirty.push_back(B); }
+		touched_list[B].push_back(u);
+	}
+
+	/* create a new block covering elems[b..e) with predecessor block F_ */
+	node_t new_block(node_t b, node_t e, node_t F_)
+	{
+		node_t B = begin.size();
+		begin.push_back(b); end.push_back(e); F.push_back(F_);
+		touched_list.emplace_back();
+		for(node_t i=b;i<e;++i){ block_of[elems[i]] = B; }
+		return B;
+	}
+
+	/* true if block X is preferred to block Y as predecessor block */
+	inline bool preferred(node_t X, node_t Y){ return sup ? begin[X] > begin[Y] : begin[X] < begin[Y]; }
+
+	/* split block D according to the predecessor blocks of its touched nodes */
+	void split(node_t D)
+	{
+		std::vector<node_t> T; std::swap(T, touched_list[D]);
+		for(node_t u : T){ touched[u] = false; }
+		if( T.empty() ){ return; }
+		// sort touched nodes by the position of their predecessor block
+		std::sort(T.begin(), T.end(), [&](node_t x, node_t y){ return begin[f[x]] < begin[f[y]]; });
+		// nodes not touched keep predecessor block F[D]
+		node_t b = begin[D], e = end[D];
+		node_t Lc = 0, Rc = 0;
+		if( F[D] == NO_NODE ){ Lc = T.size(); }
+		else
+		{
+			for(node_t u : T)
+			{
+				if( begin[f[u]] < begin[F[D]] ){ Lc++; }
+				else if( begin[f[u]] > begin[F[D]] ){ Rc++; }
+			}
+		}
+		// move left touched nodes to the prefix and right ones to the suffix of the block
+		for(node_t k=0;k<Lc;++k){ swap_elems(pos[T[k]], b+k); }
+		for(node_t k=0;k<Rc;++k){ swap_elems(pos[T[T.size()-Rc+k]], e-Rc+k); }
+		for(node_t k=0;k<Lc;++k){ elems[b+k] = T[k]; pos[T[k]] = b+k; }
+		for(node_t k=0;k<Rc;++k){ elems[e-Rc+k] = T[T.size()-Rc+k]; pos[T[T.size()-Rc+k]] = e-Rc+k; }
+		// compute the parts (begin, end, predecessor block) left to right
+		std::vector<std::pair<node_t,node_t>> parts; std::vector<node_t> part_F;
+		for(node_t k=0;k<Lc;++k)
+		{
+			if( k == 0 || f[T[k]] != f[T[k-1]] ){ parts.push_back({b+k,b+k}); part_F.push_back(f[T[k]]); }
+			parts.back().second++;
+		}
+		if( e-Rc > b+Lc ){ parts.push_back({b+Lc,e-Rc}); part_F.push_back(F[D]); }
+		for(node_t k=T.size()-Rc;k<T.size();++k)
+		{
+			node_t i = e - T.size() + k;
+			if( k == T.size()-Rc || f[T[k]] != f[T[k-1]] ){ parts.push_back({i,i}); part_F.push_back(f[T[k]]); }
+			parts.back().second++;
+		}
+		// no split: all nodes share the same predecessor block
+		if( parts.size() == 1 ){ F[D] = part_F[0]; return; }
+		// the largest part keeps the block id D
+		node_t largest = 0;
+		for(node_t p=1;p<parts.size();++p)
+			if( parts[p].second - parts[p].first > parts[largest].second - parts[largest].first ){ largest = p; }
+		std::vector<node_t> part_id(parts.size());
+		for(node_t p=0;p<parts.size();++p)
+			if( p != largest ){ part_id[p] = new_block(parts[p].first, parts[p].second, part_F[p]); }
+		begin[D] = parts[largest].first; end[D] = parts[largest].second; F[D] = part_F[largest];
+		part_id[largest] = D;
+		// scan the out-edges of all parts but the largest, in order of preference
+		stamp++; visited.clear();
+		for(node_t q=0;q<parts.size();++q)
+		{
+			node_t p = sup ? parts.size()-1-q : q;
+			if( p == largest ){ continue; }
+			for(node_t i=parts[p].first;i<parts[p].second;++i)
+			{
+				node_t x = elems[i];
+				for(uint64_t k=out_first[x];k<out_first[x+1];++k)
+				{
+					node_t u = out_nodes[k];
+					if( f[u] != D ){ continue; }
+					if( visit[u] != stamp ){ visit[u] = stamp; visited.push_back(u); best[u] = part_id[p]; bcnt[u] = 0; dsum[u] = 0; }
+					if( best[u] == part_id[p] ){ bcnt[u]++; }
+					dsum[u]++;
+				}
+			}
+		}
+		// resolve the new predecessor block of every visited node
+		for(node_t u : visited)
+		{
+			if( preferred(best[u], D) || c[u] == dsum[u] ){ f[u] = best[u]; c[u] = bcnt[u]; touch(u); }
+			else{ c[u] -= dsum[u]; }
+		}
+	}
+
+	/* swap two positions of the elems array */
+	inline void swap_elems(node_t i, node_t j)
+	{
+		std::swap(elems[i], elems[j]);
+		pos[elems[i]] = i; pos[elems[j]] = j;
+	}
+
+public:
+	// empty constructor
+	partition_refinement(){}
+	/*
+	* Constructor that takes in input a graph and computes the co-lex order of
+	* the infimum strings (sup == false) or supremum strings (sup == true).
+	* Sources (nodes without incoming edges) are placed first.
+	*/
+	partition_refinement(const labeled_graph& G, bool sup_): sup(sup_), n(G.n)
+	{
+		// compute lambda: minimum (maximum) incoming label of each node
+		lambda.assign(n, 0); std::vector<bool> has_in(n, false);
+		for(uint64_t k=0;k<G.no_edges();++k)
+		{
+			node_t d = G.dest[k];
+			if( !has_in[d] || (sup ? G.label[k] > lambda[d] : G.label[k] < lambda[d]) ){ lambda[d] = G.label[k]; }
+			has_in[d] = true;
+		}
+		// keep only edges labeled lambda and build the out-adjacency lists
+		out_first.assign(n+1, 0);
+		for(uint64_t k=0;k<G.no_edges();++k)
+			if( G.label[k] == lambda[G.dest[k]] ){ out_first[G.origin[k]+1]++; }
+		for(node_t i=0;i<n;++i){ out_first[i+1] += out_first[i]; }
+		out_nodes.resize(out_first[n]);
+		{
+			std::vector<uint64_t> next(out_first.begin(), out_first.end()-1);
+			for(uint64_t k=0;k<G.no_edges();++k)
+				if( G.label[k] == lambda[G.dest[k]] ){ out_nodes[next[G.origin[k]]++] = G.dest[k]; }
+		}
+		init(has_in);
+	}
+
+	/*
+	* Constructor that takes in input a pseudoforest and computes the equivalence
+	* classes of its nodes (nodes reached by the same string), ordered co-lex.
+	*/
+	partition_refinement(const pseudoforest& P): sup(false), n(P.size())
+	{
+		lambda = P.label;
+		std::vector<bool> has_in(n, false);
+		out_first.assign(n+1, 0);
+		for(node_t i=0;i<n;++i)
+			if( P.pred[i] != NO_NODE ){ out_first[P.pred[i]+1]++; has_in[i] = true; }
+		for(node_t i=0;i<n;++i){ out_first[i+1] += out_first[i]; }
+		out_nodes.resize(out_first[n]);
+		std::vector<uint64_t> next(out_first.begin(), out_first.end()-1);
+		for(node_t i=0;i<n;++i)
+			if( P.pred[i] != NO_NODE ){ out_nodes[next[P.pred[i]]++] = i; }
+		init(has_in);
+	}
+
+	/* get number of equivalence classes */
+	node_t no_classes(){ return begin.size(); }
+
+	/* get rank of the class containing node u */
+	node_t class_rank(node_t u){ return rank[block_of[u]]; }
+
+	/*
+	* return the pruned and compacted pseudoforest: one node per class, reached
+	* from the class of its leftmost (rightmost) predecessor.
+	*/
+	pseudoforest quotient()
+	{
+		pseudoforest P;
+		P.pred.resize(no_classes()); P.label.resize(no_classes());
+		for(node_t B=0;B<no_classes();++B)
+		{
+			P.pred[rank[B]] = (F[B] == NO_NODE) ? NO_NODE : rank[F[B]];
+			P.label[rank[B]] = lambda[elems[begin[B]]];
+		}
+		return P;
+	}
+
+private:
+	/* build the initial partition (sources, then by lambda) and refine it */
+	void init(const std::vector<bool>& has_in)
+	{
+		// bucket sort nodes by (has_in, lambda)
+		std::vector<node_t> cnt(258, 0);
+		for(node_t u=0;u<n;++u){ cnt[has_in[u] ? lambda[u]+2 : 1]++; }
+		for(node_t i=1;i<258;++i){ cnt[i] += cnt[i-1]; }
+		elems.resize(n); pos.resize(n); block_of.resize(n);
+		for(node_t u=0;u<n;++u){ node_t k = cnt[has_in[u] ? lambda[u]+1 : 0]++; elems[k] = u; pos[u] = k; }
+		for(node_t i=0;i<n;++i)
+			if( i == 0 || (has_in[elems[i]] != has_in[elems[i-1]]) || (lambda[elems[i]] != lambda[elems[i-1]]) )
+			{
+				node_t j = i;
+				while( j < n && has_in[elems[j]] == has_in[elems[i]] && lambda[elems[j]] == lambda[elems[i]] ){ j++; }
+				new_block(i, j, NO_NODE);
+			}
+		// compute the preferred predecessor block and its multiplicity for each node
+		f.assign(n, NO_NODE); c.assign(n, 0);
+		for(node_t x=0;x<n;++x)
+			for(uint64_t k=out_first[x];k<out_first[x+1];++k)
+			{
+				node_t u = out_nodes[k], B = block_of[x];
+				if( f[u] == NO_NODE || preferred(B, f[u]) ){ f[u] = B; c[u] = 1; }
+				else if( f[u] == B ){ c[u]++; }
+			}
+		// every non-source node is touched
+		touched.assign(n, false); visit.assign(n, 0); stamp = 0;
+		best.resize(n); bcnt.resize(n); dsum.resize(n);
+		for(node_t u=0;u<n;++u)
+			if( has_in[u] ){ touch(u); }
+		// split blocks until the partition is stable
+		while( !dirty.empty() )
+		{
+			node_t D = dirty.back(); dirty.pop_back();
+			split(D);
+		}
+		// rank blocks left to right
+		rank.resize(begin.size());
+		for(node_t B=0;B<begin.size();++B){ rank[B] = B; }
+		std::sort(rank.begin(), rank.end(), [&](node_t x, node_t y){ return begin[x] < begin[y]; });
+		std::vector<node_t> inv(rank.size());
+		for(node_t r=0;r<rank.size();++r){ inv[rank[r]] = r; }
+		rank.swap(inv);
+		// release working space
+		std::vector<node_t>().swap(c); std::vector<node_t>().swap(best);
+		std::vector<node_t>().swap(bcnt); std::vector<node_t>().swap(dsum);
+		std::vector<uint64_t>().swap(visit); std::vector<bool>().swap(touched);
+	}
+
+	// true if we compute supremum strings
+	bool sup;
+	// number of nodes
+	node_t n;
+	// label of the (pruned) incoming edges of each node
+	std::vector<label_t> lambda;
+	// out-adjacency lists of the pruned graph
+	std::vector<uint64_t> out_first;
+	std::vector<node_t> out_nodes;
+	// nodes sorted by block, position of each node, block of each node
+	std::vector<node_t> elems, pos, block_of;
+	// blocks: elems[begin..end), common predecessor block F, rank
+	std::vector<node_t> begin, end, F, rank;
+	// preferred predecessor block of each node and number of predecessors in it
+	std::vector<node_t> f, c;
+	// touched nodes of each block and blocks with touched nodes
+	std::vector<bool> touched;
+	std::vector<std::vector<node_t>> touched_list;
+	std::vector<node_t> dirty;
+	// scan working space
+	std::vector<uint64_t> visit; uint64_t stamp;
+	std::vector<node_t> visited, best, bcnt, dsum;
+};
+
+/*
+* Compute the deterministic Wheeler pseudoforest G_is: the disjoint union of the
+* pruned infimum and supremum graphs, sorted together. Equal strings of the two
+* components are kept as distinct nodes, infimum first.
+*/
+pseudoforest infsup_pseudoforest(const labeled_graph& G, bool verb = false)
+{
+	// compute infimum and supremum orders in parallel
+	pseudoforest Pinf, Psup;
+	std::thread t_inf([&](){ partition_refinement R(G,false); Pinf = R.quotient(); });
+	std::thread t_sup([&](){ partition_refinement R(G,true);  Psup = R.quotient(); });
+	t_inf.join(); t_sup.join();
+	if(verb) std::cout << "infimum classes: " << Pinf.size() << " - supremum classes: " << Psup.size() << std::endl;
+
+	// disjoint union of the two pseudoforests
+	node_t k = Pinf.size(), N = Pinf.size() + Psup.size();
+	pseudoforest U;
+	U.pred = Pinf.pred; U.label = Pinf.label;
+	for(node_t i=0;i<Psup.size();++i)
+	{
+		U.pred.push_back(Psup.pred[i] == NO_NODE ? NO_NODE : Psup.pred[i] + k);
+		U.label.push_back(Psup.label[i]);
+	}
+	// counting sort of the union by (class rank, component)
+	partition_refinement R(U);
+	std::vector<node_t> inv(R.no_classes()+1,0), order(N);
+	for(node_t i=0;i<N;++i){ inv[R.class_rank(i)+1]++; }
+	for(node_t r=0;r<R.no_classes();++r){ inv[r+1] += inv[r]; }
+	for(node_t i=0;i<N;++i){ order[inv[R.class_rank(i)]++] = i; }
+	inv.resize(N);
+	for(node_t i=0;i<N;++i){ inv[order[i]] = i; }
+	// relabel nodes
+	pseudoforest P;
+	P.pred.resize(N); P.label.resize(N);
+	for(node_t i=0;i<N;++i)
+	{
+		P.pred[i] = (U.pred[order[i]] == NO_NODE) ? NO_NODE : inv[U.pred[order[i]]];
+		P.label[i] = U.label[order[i]];
+	}
+
+	return P;
+}
+
+}
+
+#endif /* INTERNAL_PARTITION_REFINEMENT_HPP_ */
@@ -0,0 +1,88 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  ring_buffer: FIFO queue stored in a preallocated circular array whose capacity
+ *               is a power of two. Pushes and pops never allocate while the queue
+ *               fits the capacity; a full buffer doubles its capacity, so the
+ *               memory is allocated once when the capacity bounds the queue size.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_RING_BUFFER_HPP_
+#define INTERNAL_RING_BUFFER_HPP_
+
+#include "common.hpp"
+
+namespace wg{
+
+template<class T>
+class ring_buffer{
+
+private:
+	/* move the values to a circular array of capacity cap */
+	void reallocate(uint64_t cap)
+	{
+		std::vector<T> buf(cap);
+		for(uint64_t i=0;i<count;++i){ buf[i] = data[(head+i) & mask]; }
+		data.swap(buf);
+		head = 0; mask = cap-1;
+	}
+
+public:
+	// empty constructor
+	ring_buffer(){}
+	/* Constructor that preallocates a capacity of at least cap values */
+	ring_buffer(uint64_t cap){ reserve(cap); }
+
+	/* grow the capacity to at least cap values, rounded up to a power of two */
+	void reserve(uint64_t cap)
+	{
+		uint64_t c = 1;
+		while( c < cap ){ c <<= 1; }
+		if( c > data.size() ){ reallocate(c); }
+	}
+
+	/* append x to the back of the queue */
+	void push(const T& x)
+	{
+		if( count == data.size() ){ reallocate(data.empty() ? 64 : 2*data.size()); }
+		data[(head+count) & mask] = x;
+		count++;
+	}
+
+	/* get the front of the queue */
+	const T& front() const
+	{
+		assert(count > 0);
+		return data[head];
+	}
+
+	/* remove the front of the queue */
+	void pop()
+	{
+		assert(count > 0);
+		head = (head+1) & mask;
+		count--;
+	}
+
+	/* get number of values in the queue */
+	uint64_t size() const { return count; }
+	/* tell if the queue is empty */
+	bool empty() const { return count == 0; }
+	/* get number of values that fit without reallocating */
+	uint64_t capacity() const { return data.size(); }
+
+private:
+	// circular array, index of the front and number of values
+	std::vector<T> data;
+	uint64_t head = 0, count = 0;
+	// capacity - 1
+	uint64_t mask = 0;
+};
+
+}
+
+#endif /* INTERNAL_RING_BUFFER_HPP_ */
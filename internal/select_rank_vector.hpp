@@ -0,0 +1,110 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ * select_rank_vector: bitvector answering rank_0(select_1(i)), i.e. the number of
+ *                     zeros preceding the ith one, with a single lookup in an
+ *                     explicit bit-compressed mapping. Used as bit_vec_t of the
+ *                     out bitvector of wg_fm_index, where it maps a node to the
+ *                     start of its outgoing labels in L; it takes (no. ones + 1)
+ *                     words of log(no. zeros) bits and the bitvector is not kept.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_SELECT_RANK_VECTOR_HPP_
+#define INTERNAL_SELECT_RANK_VECTOR_HPP_
+
+#include "common.hpp"
+
+namespace wg{
+
+class select_rank_vector{
+
+public:
+
+	/*
+	 * empty constructor. Initialize bitvector with length 0.
+	 */
+	select_rank_vector(){}
+
+	/*
+	 * constructor that builds the mapping of u bits packed in 64-bit words
+	 */
+	select_rank_vector(const uint64_t* words, uint64_t u_): u(u_){
+		if(u==0)
+		{
+			std::cerr << "Error! empty bitvector, exiting...\n";
+			exit(1);
+		}
+		// count the ones
+		uint64_t ones = 0, no_words = (u+63)/64;
+		for(uint64_t w=0;w<no_words;++w)
+			ones += __builtin_popcountll(mask_word(words, w));
+		// width of the number of zeros
+		uint8_t width = 1;
+		while(width < 64 and ((u-ones) >> width) > 0){ width++; }
+		map = sdsl::int_vector<>(ones+1, 0, width);
+		// store the zeros preceding each one
+		uint64_t k = 0;
+		for(uint64_t w=0;w<no_words;++w)
+			for(uint64_t word = mask_word(words, w); word != 0; word &= word-1)
+			{
+				k++;
+				map[k] = w*64 + __builtin_ctzll(word) - (k-1);
+			}
+	}
+
+	/*
+	 * serialize the bitvector to an output stream
+	 */
+	void serialize(std::ostream& out) const {
+		out.write(reinterpret_cast<const char*>(&u), sizeof(u));
+		map.serialize(out);
+	}
+
+	/*
+	 * load a bitvector serialized with serialize()
+	 */
+	void load(std::istream& in){
+		in.read(reinterpret_cast<char*>(&u), sizeof(u));
+		map.load(in);
+	}
+
+	/* identifier of the serialization format */
+	static uint64_t type_id(){ return 2; }
+
+	/*
+	*  get the size of the bitvector
+	*/
+	uint64_t size(){return u;}
+
+	/* number of zeros preceding the ith one, 0 for i = 0 */
+	uint64_t rank_0_select_1(uint64_t i)
+	{
+		// check index size
+		assert(i<map.size());
+
+		return map[i];
+	}
+
+private:
+
+	/* get the wth word with the bits past u cleared */
+	uint64_t mask_word(const uint64_t* words, uint64_t w) const
+	{
+		if(w == u/64 and u%64 != 0)
+			return words[w] & ((uint64_t(1) << (u%64)) - 1);
+		return words[w];
+	}
+
+	//bitvector length
+	uint64_t u = 0;
+	// zeros preceding each one
+	sdsl::int_vector<> map;
+};
+
+}
+
+#endif /* INTERNAL_SELECT_RANK_VECTOR_HPP_ */
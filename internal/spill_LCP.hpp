@@ -0,0 +1,149 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  spill_LCP: external storage for LCP values produced in arbitrary position
+ *             order. The (position, value) records are buffered in memory and
+ *             spilled to a temporary file as runs sorted by position; merge()
+ *             combines the runs with a k-way merge and streams the final LCP
+ *             vector to the output file, with INF for the missing positions.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_SPILL_LCP_HPP_
+#define INTERNAL_SPILL_LCP_HPP_
+
+#include "common.hpp"
+
+namespace wg{
+
+template<class uint_t = ::uint_t>
+class spill_LCP{
+
+private:
+	// (position, LCP value) record
+	typedef std::pair<uint_t,uint_t> record;
+
+	/* sort the buffered records and append them to the spill file as a new run */
+	void flush_run()
+	{
+		if(buffer.empty()){ return; }
+		std::sort(buffer.begin(), buffer.end());
+		runs.push_back(std::make_pair(no_records, buffer.size()));
+		if(fwrite(buffer.data(), sizeof(record), buffer.size(), spill) != buffer.size())
+		{
+			std::cerr << "Error! cannot write " << spill_path << ", exiting...\n";
+			exit(1);
+		}
+		no_records += buffer.size();
+		buffer.clear();
+	}
+
+	/* cursor reading a sorted run of the spill file in blocks */
+	struct run_cursor{
+		uint64_t next, end;
+		std::vector<record> buf;
+		size_t i = 0;
+
+		/* load the next block of records, return false at the end of the run */
+		bool refill(FILE* f, uint64_t block)
+		{
+			if(next == end){ return false; }
+			buf.resize(std::min(block, end - next)); i = 0;
+			fseek(f, next*sizeof(record), SEEK_SET);
+			if(fread(buf.data(), sizeof(record), buf.size(), f) != buf.size())
+			{
+				std::cerr << "Error! cannot read the spill file, exiting...\n";
+				exit(1);
+			}
+			next += buf.size();
+			return true;
+		}
+	};
+
+public:
+	/*
+	* Constructor that takes in input the path of the temporary spill file, the
+	* length n of the LCP vector and the maximum number of buffered records
+	*/
+	spill_LCP(std::string filepath, uint_t n_, uint64_t capacity_): spill_path(filepath), n(n_), capacity(capacity_)
+	{
+		spill = std::fopen(spill_path.c_str(), "w+");
+		if(spill == nullptr){ std::cerr << "Error! cannot open " << spill_path << ", exiting...\n"; exit(1); }
+		buffer.reserve(capacity);
+	}
+
+	spill_LCP(const spill_LCP&) = delete;
+	spill_LCP & operator= (const spill_LCP&) = delete;
+
+	~spill_LCP()
+	{
+		if(spill != nullptr){ std::fclose(spill); std::remove(spill_path.c_str()); }
+	}
+
+	/* store LCP[i] = val */
+	void push(uint_t i, uint_t val)
+	{
+		buffer.push_back(std::make_pair(i,val));
+		if(buffer.size() >= capacity){ flush_run(); }
+	}
+
+	/* get number of sorted runs in the spill file */
+	uint64_t no_runs(){ return runs.size(); }
+
+	/* merge the sorted runs and write the LCP vector to ofile_path */
+	void merge(std::string ofile_path)
+	{
+		flush_run(); fflush(spill);
+		// split the buffer memory among the runs
+		uint64_t block = std::max<uint64_t>(capacity / std::max<uint64_t>(runs.size(),1), 1024);
+		std::vector<run_cursor> cursors(runs.size());
+		// min-heap of (position, run)
+		std::priority_queue<std::pair<uint_t,uint64_t>, std::vector<std::pair<uint_t,uint64_t>>,
+		                    std::greater<std::pair<uint_t,uint64_t>>> heap;
+		for(uint64_t r=0;r<runs.size();++r)
+		{
+			cursors[r].next = runs[r].first; cursors[r].end = runs[r].first + runs[r].second;
+			if(cursors[r].refill(spill, block)){ heap.push(std::make_pair(cursors[r].buf[0].first, r)); }
+		}
+		// stream the LCP vector
+		FILE* ofile = std::fopen(ofile_path.c_str(), "w");
+		if(ofile == nullptr){ std::cerr << "Error! cannot open " << ofile_path << ", exiting...\n"; exit(1); }
+		std::vector<uint_t> out; out.reserve(1 << 16);
+		auto put = [&](uint_t v){ out.push_back(v); if(out.size() == out.capacity()){ fwrite(out.data(), sizeof(uint_t), out.size(), ofile); out.clear(); } };
+		uint_t i = 0;
+		while(not heap.empty())
+		{
+			uint64_t r = heap.top().second; heap.pop();
+			run_cursor& c = cursors[r];
+			// fill missing positions with INF
+			for(;i<c.buf[c.i].first;++i){ put(INF); }
+			put(c.buf[c.i].second); i++;
+			// advance the run
+			if(++c.i < c.buf.size() or c.refill(spill, block))
+				heap.push(std::make_pair(c.buf[c.i].first, r));
+		}
+		for(;i<n;++i){ put(INF); }
+		fwrite(out.data(), sizeof(uint_t), out.size(), ofile);
+		fclose(ofile);
+	}
+
+private:
+	// spill file
+	std::string spill_path;
+	FILE* spill = nullptr;
+	// length of the LCP vector
+	uint_t n;
+	// in-memory records and maximum number of buffered records
+	std::vector<record> buffer;
+	uint64_t capacity;
+	// (offset, length) in records of the runs in the spill file
+	std::vector<std::pair<uint64_t,uint64_t>> runs;
+	uint64_t no_records = 0;
+};
+
+}
+
+#endif /* INTERNAL_SPILL_LCP_HPP_ */
@@ -0,0 +1,93 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  stabbing_kernels: SIMD kernels of the interval stabbing block scans. A kernel
+ *                    computes, for every code c < sigma, the bitmask of the block
+ *                    positions holding c, from which the first and last occurrence
+ *                    of c around a position are read with ctz/clz. The AVX2 and
+ *                    AVX-512BW kernels are compiled with target attributes and picked
+ *                    at runtime; without them the caller keeps its scalar scan.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_STABBING_KERNELS_HPP_
+#define INTERNAL_STABBING_KERNELS_HPP_
+
+#include "common.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WG_STABBING_KERNELS 1
+#endif
+
+namespace wg{
+
+/*
+ * kernel writing in masks[c*words+w] the wth 64-bit word of the equality bitmask
+ * of code c over the block of width = 64*words codes, for all codes c < sigma
+ */
+typedef void (*eq_masks_kernel)(const uint8_t* block, uint64_t words, uint64_t sigma, uint64_t* masks);
+
+#ifdef WG_STABBING_KERNELS
+
+__attribute__((target("avx2")))
+inline void eq_masks_avx2(const uint8_t* block, uint64_t words, uint64_t sigma, uint64_t* masks)
+{
+	// the block has at most 256 codes
+	__m256i v[8];
+	for(uint64_t w=0;w<2*words;++w)
+		v[w] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32*w));
+	for(uint64_t c=0;c<sigma;++c)
+	{
+		__m256i cv = _mm256_set1_epi8(char(c));
+		for(uint64_t w=0;w<words;++w)
+		{
+			uint64_t lo = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v[2*w], cv)));
+			uint64_t hi = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v[2*w+1], cv)));
+			masks[c*words+w] = lo | (hi << 32);
+		}
+	}
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void eq_masks_avx512(const uint8_t* block, uint64_t words, uint64_t sigma, uint64_t* masks)
+{
+	// the block has at most 256 codes
+	__m512i v[4];
+	for(uint64_t w=0;w<words;++w)
+		v[w] = _mm512_loadu_si512(reinterpret_cast<const void*>(block + 64*w));
+	for(uint64_t c=0;c<sigma;++c)
+	{
+		__m512i cv = _mm512_set1_epi8(char(c));
+		for(uint64_t w=0;w<words;++w)
+			masks[c*words+w] = _mm512_cmpeq_epi8_mask(v[w], cv);
+	}
+}
+
+#endif
+
+/*
+ * pick the widest kernel supported by the CPU and set the largest alphabet for
+ * which it beats the scalar scan: the kernel costs a compare per code and vector
+ * instead of a scattered store per position, so it only wins on small alphabets
+ * (measured up to 4x faster for sigma = 4, slower from sigma = 32 on 64-code blocks);
+ * returns nullptr if no kernel is available
+ */
+inline eq_masks_kernel select_eq_masks_kernel(uint64_t& max_sigma)
+{
+	max_sigma = 16;
+#ifdef WG_STABBING_KERNELS
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512bw")){ return eq_masks_avx512; }
+	if(__builtin_cpu_supports("avx2")){ return eq_masks_avx2; }
+#endif
+	max_sigma = 0;
+	return nullptr;
+}
+
+}
+
+#endif /* INTERNAL_STABBING_KERNELS_HPP_ */
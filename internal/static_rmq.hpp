@@ -3,7 +3,8 @@
 // by a MIT license that can be found in the LICENSE file.
 
 /*
- * static_rmq: a wrapper on the sdsl rmq_succinct_sct RMQ implementation
+ * static_rmq: a wrapper on the sdsl rmq_succinct_sct RMQ implementation, working on
+ *             an int_vector or on a wg::mmap_vector mapped on the output file
  */
 
 //============================================================================
@@ -12,9 +13,11 @@
 #define INTERNAL_STATIC_RMQ_HPP_
 
 #include "common.hpp"
+#include "compact_LCP_vector.hpp"
 
 namespace ds{
 
+template<class uint_t = ::uint_t, class vec_t = sdsl::int_vector<sizeof(uint_t)*8>>
 class static_rmq{
 
 private:
@@ -23,6 +26,9 @@ private:
 	class iterator;
 
 public:
+	// index width and type of the LCP vector
+	typedef uint_t uint_type;
+	typedef vec_t vector_type;
 
 	/*
 	 * empty constructor.
@@ -32,11 +38,12 @@ public:
 	/*
 	 *
 	 * constructor that initializes a LCP vector of size n
-	 * and the pointer to RMQ data structure.
+	 * (mapped on ofile_path if file-backed) and the pointer
+	 * to RMQ data structure.
 	 */
-	static_rmq(uint_t n_): n(n_){
+	static_rmq(uint_t n_, std::string ofile_path = ""): n(n_){
 		// initialize the LCP array
-		LCP = new int_vector(n,EMPTY);
+		LCP = new vec_t(); init_LCP(*LCP,ofile_path,n,EMPTY);
 		// init rmq pointer to null
 		rmq = nullptr;
 	}
@@ -46,14 +53,23 @@ public:
 	iterator begin() { /* return pointer to first entry in the LCP array */ return iterator(LCP,0); }
 	iterator end(){ /* return pointer to last entry in the LCP array */ return iterator(LCP,n); }
 
-	static_rmq & operator= (const static_rmq & other) {
+	static_rmq(const static_rmq&) = delete;
+	static_rmq & operator= (const static_rmq&) = delete;
 
-		n = other.n;
-		LCP = other.LCP;
-		rmq = other.rmq;
+	static_rmq & operator= (static_rmq && other) {
+
+		std::swap(n, other.n);
+		std::swap(LCP, other.LCP);
+		std::swap(rmq, other.rmq);
 
 	    return *this;
 	}
+
+	~static_rmq()
+	{
+		delete rmq;
+		delete LCP;
+	}
 	
 	/* update RMQ ds according to the current LCP vector */
 	void update_rmq_support()
@@ -97,7 +113,7 @@ public:
 	}
 
 	/* return pointer to the LCP vector */
-	int_vector* get_LCP_vector()
+	vec_t* get_LCP_vector()
 	{
 		return LCP;
 	}
@@ -105,11 +121,11 @@ public:
 private:
 
 	// vector length
-	uint_t n;
+	uint_t n = 0;
 	// LCP array
-	int_vector* LCP;
+	vec_t* LCP = nullptr;
 	// RMQ data structure
-	sdsl::rmq_succinct_sct<>* rmq;
+	sdsl::rmq_succinct_sct<>* rmq = nullptr;
 	
 	// iterator class for the LCP vector
     class iterator
@@ -117,7 +133,7 @@ private:
     	public:
 
 	        iterator():                    v(nullptr), i(0) {}
-	        iterator(int_vector* v, uint_t i): v(v),       i(i) {}
+	        iterator(vec_t* v, uint_t i):      v(v),       i(i) {}
 
 	        uint_t       operator*()             {return (*v)[i];}
 	        const uint_t operator*()       const {return (*v)[i];}
@@ -132,7 +148,7 @@ private:
 
     	private:
     		// pointer to LCP vector
-    		int_vector* v;
+    		vec_t* v;
     		// position in LCP vector
     		uint_t        i;
     };
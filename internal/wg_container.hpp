@@ -0,0 +1,348 @@
+// Copyright (c) 2024, REGINDEX.  All rights reserved.
+// Use of this source code is governed
+// by a MIT license that can be found in the LICENSE file.
+
+/*
+ *  wg_container: bit-packed binary container for a Wheeler pseudoforest, mapped
+ *                in memory with mmap. The file layout is (all fields are 64-bit
+ *                little-endian words, every section starts at a word boundary):
+ *
+ *      header: magic, version, no. nodes, L length, no. sources, sigma,
+ *              out length (bits), in length (bits), C[0..255]
+ *              (C[c] = number of labels smaller than c),
+ *              L offset, out offset, in offset (in bytes)
+ *      L:      one byte per outgoing label, padded to a multiple of 8 bytes
+ *      out:    out-degree bitvector, bit i stored in word i/64 at position i%64
+ *      in:     in-degree bitvector, same layout as out
+ *
+ *  The bitvector layout matches the one of sdsl::bit_vector, so the words can be
+ *  copied directly. The same image is built in memory by from_triple(), which
+ *  streams each of the .L/.in/.out files once, or by from_view(), which copies
+ *  a graph_view of in-memory arrays; all index structures are then constructed
+ *  from the container. This header does not depend on sdsl.
+ */
+
+//============================================================================
+
+#ifndef INTERNAL_WG_CONTAINER_HPP_
+#define INTERNAL_WG_CONTAINER_HPP_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace wg{
+
+/* header of the binary container */
+struct wg_header{
+	uint64_t magic;
+	uint64_t version;
+	uint64_t no_nodes;
+	uint64_t L_length;
+	uint64_t sources;
+	uint64_t sigma;
+	uint64_t out_length;
+	uint64_t in_length;
+	uint64_t C[256];
+	uint64_t L_offset;
+	uint64_t out_offset;
+	uint64_t in_offset;
+};
+
+/*
+ * In-memory Wheeler pseudoforest: the outgoing labels L and the out/in-degree
+ * bitvectors packed in 64-bit words with the layout of the container.
+ */
+struct graph_view{
+	const uint8_t* L = nullptr;
+	uint64_t L_length = 0;
+	const uint64_t* out = nullptr;
+	uint64_t out_length = 0;
+	const uint64_t* in = nullptr;
+	uint64_t in_length = 0;
+};
+
+class wg_container{
+
+private:
+	// "WGPFOR01" in little-endian
+	static constexpr uint64_t MAGIC = 0x3130524f46505747ULL;
+	static constexpr uint64_t VERSION = 1;
+
+	/* number of 64-bit words needed to store u bits */
+	static uint64_t no_words(uint64_t u){ return (u+63)/64; }
+
+	/* get the size of a file */
+	static uint64_t file_size(std::string filepath)
+	{
+		struct stat st;
+		if(stat(filepath.c_str(), &st) != 0){ std::cerr << "Error! cannot open " << filepath << ", exiting...\n"; exit(1); }
+		return st.st_size;
+	}
+
+	/* read a file of ASCII '0'/'1' bits and pack it into 64-bit words */
+	static void read_bits(std::string filepath, uint64_t* words)
+	{
+		FILE* f = std::fopen(filepath.c_str(), "r");
+		if(f == nullptr){ std::cerr << "Error! cannot open " << filepath << ", exiting...\n"; exit(1); }
+		std::vector<char> buf(1 << 20);
+		uint64_t i = 0; size_t len;
+		// stream the file in 64-bit aligned chunks
+		while((len = fread(buf.data(), 1, buf.size(), f)) > 0)
+		{
+			for(size_t k=0;k<len;++k,++i)
+				words[i/64] |= uint64_t(buf[k] == '1') << (i%64);
+		}
+		std::fclose(f);
+	}
+
+	/* get ith bit of a packed bitvector */
+	static bool get_bit(const uint64_t* words, uint64_t i){ return (words[i/64] >> (i%64)) & 1; }
+
+	/* compute the section offsets of the header from the section lengths */
+	static void set_offsets(wg_header& h)
+	{
+		h.magic = MAGIC; h.version = VERSION;
+		h.L_offset = sizeof(wg_header);
+		h.out_offset = h.L_offset + no_words(h.L_length*8)*8;
+		h.in_offset = h.out_offset + no_words(h.out_length)*8;
+	}
+
+	/* check that the sections of a header are laid out by set_offsets and fit in size bytes */
+	static bool valid_layout(const wg_header& h, uint64_t size)
+	{
+		// bound the lengths first, so that the offsets below cannot overflow
+		if(h.L_length > size or h.out_length/8 > size or h.in_length/8 > size){ return false; }
+		wg_header e = h;
+		set_offsets(e);
+		return h.L_offset == e.L_offset and h.out_offset == e.out_offset and h.in_offset == e.in_offset and
+		       h.in_offset + no_words(h.in_length)*8 <= size;
+	}
+
+	/*
+	* Compute the number of nodes, the number of sources, sigma and the C array
+	* of a filled image and store its header. Checks that all nodes except the
+	* sources have exactly one incoming edge; returns false and sets error if the
+	* image is not a valid Wheeler pseudoforest.
+	*/
+	bool finalize(wg_header& h, std::string& error)
+	{
+		const uint8_t* L = reinterpret_cast<const uint8_t*>(storage.data()) + h.L_offset;
+		const uint64_t* in = storage.data() + h.in_offset/8;
+		// compute the number of sources and check the in-degrees
+		while(h.sources < h.in_length && get_bit(in, h.sources)){ h.sources++; }
+		for(uint64_t i=h.sources;i<h.in_length;i+=2)
+			if(get_bit(in, i) || i+1 >= h.in_length || !get_bit(in, i+1))
+			{
+				error = "all nodes must have exactly one incoming edge";
+				return false;
+			}
+		h.no_nodes = h.sources + h.L_length;
+		if(h.in_length != h.no_nodes + h.L_length || h.out_length != h.no_nodes + h.L_length)
+		{
+			error = "the L, in and out sequences are not consistent";
+			return false;
+		}
+		if(h.L_length == 0){ error = "the graph has no edges"; return false; }
+		// the out bitvector closes the out-edges of each node with a one
+		const uint64_t* out = storage.data() + h.out_offset/8;
+		uint64_t ones = 0;
+		for(uint64_t w=0;w<no_words(h.out_length);++w){ ones += __builtin_popcountll(out[w]); }
+		if(ones != h.no_nodes){ error = "the out sequence must have one 1 per node"; return false; }
+		// compute the C array
+		for(uint64_t i=0;i<h.L_length;++i){ h.C[L[i]]++; }
+		if(h.C[0] != 0){ error = "the label 0 is reserved"; return false; }
+		uint64_t sum = 0;
+		for(uint64_t c=0;c<256;++c)
+		{
+			if(h.C[c] != 0){ h.sigma++; }
+			uint64_t freq = h.C[c]; h.C[c] = sum; sum += freq;
+		}
+		// store header
+		memcpy(storage.data(), &h, sizeof(h));
+		set_base(storage.data(), storage.size()*8);
+
+		return true;
+	}
+
+	/* set pointers to the container image */
+	void set_base(void* base_, size_t size_)
+	{
+		base = base_; size = size_;
+		header = reinterpret_cast<const wg_header*>(base);
+	}
+
+public:
+	// empty constructor
+	wg_container(){}
+	/*
+	* Constructor that maps in memory a container written by convert()
+	*/
+	wg_container(std::string filepath)
+	{
+		// open and map the file
+		int fd = open(filepath.c_str(), O_RDONLY);
+		if(fd < 0){ std::cerr << "Error! cannot open " << filepath << ", exiting...\n"; exit(1); }
+		struct stat st; fstat(fd, &st);
+		size = st.st_size;
+		if(size < sizeof(wg_header)){ std::cerr << "Error! " << filepath << " is not a valid container, exiting...\n"; exit(1); }
+		void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if(addr == MAP_FAILED){ std::cerr << "Error! cannot map " << filepath << ", exiting...\n"; exit(1); }
+		set_base(addr, size); mapped = true;
+		// check header and sections
+		if(header->magic != MAGIC || header->version != VERSION || !valid_layout(*header, size))
+		{
+			std::cerr << "Error! " << filepath << " is not a valid container, exiting...\n";
+			exit(1);
+		}
+		// the bitvectors are scanned sequentially
+		madvise(base, size, MADV_SEQUENTIAL);
+	}
+
+	wg_container(const wg_container&) = delete;
+	wg_container & operator= (const wg_container&) = delete;
+
+	wg_container(wg_container&& other){ *this = std::move(other); }
+	wg_container & operator= (wg_container&& other)
+	{
+		clear();
+		storage.swap(other.storage); std::swap(mapped, other.mapped);
+		set_base(other.base, other.size);
+		other.base = nullptr; other.size = 0; other.header = nullptr;
+		return *this;
+	}
+
+	~wg_container(){ clear(); }
+
+	/* release the container memory */
+	void clear()
+	{
+		if(mapped){ munmap(base, size); }
+		std::vector<uint64_t>().swap(storage);
+		base = nullptr; size = 0; header = nullptr; mapped = false;
+	}
+
+	/*
+	* Build the container image in memory from the .L/.in/.out files of a Wheeler
+	* pseudoforest, reading each file once. Checks that all nodes except the
+	* sources have exactly one incoming edge.
+	*/
+	static wg_container from_triple(std::string basepath)
+	{
+		wg_header h; memset(&h, 0, sizeof(h));
+		h.L_length = file_size(basepath+".L");
+		h.out_length = file_size(basepath+".out");
+		h.in_length = file_size(basepath+".in");
+		set_offsets(h);
+
+		wg_container wgc;
+		wgc.storage.assign((h.in_offset/8) + no_words(h.in_length), 0);
+		uint8_t* L = reinterpret_cast<uint8_t*>(wgc.storage.data()) + h.L_offset;
+		// read L
+		FILE* f = std::fopen((basepath+".L").c_str(), "r");
+		if(f == nullptr || fread(L, 1, h.L_length, f) != h.L_length)
+		{
+			std::cerr << "Error! cannot read " << basepath << ".L, exiting...\n";
+			exit(1);
+		}
+		std::fclose(f);
+		// read and pack the bitvectors
+		read_bits(basepath+".out", wgc.storage.data() + h.out_offset/8);
+		read_bits(basepath+".in", wgc.storage.data() + h.in_offset/8);
+		// compute the header
+		std::string error;
+		if(!wgc.finalize(h, error))
+		{
+			std::cerr << "Error! " << error << ", exiting..." << std::endl;
+			exit(1);
+		}
+
+		return wgc;
+	}
+
+	/*
+	* Build the container image in memory from a graph_view, copying the arrays.
+	* Returns false and sets error, without exiting, if the view is not a valid
+	* Wheeler pseudoforest.
+	*/
+	static bool from_view(const graph_view& g, wg_container& wgc, std::string& error)
+	{
+		if((g.L == nullptr && g.L_length > 0) || (g.out == nullptr && g.out_length > 0) ||
+		   (g.in == nullptr && g.in_length > 0))
+		{
+			error = "null array in the graph view";
+			return false;
+		}
+		wg_header h; memset(&h, 0, sizeof(h));
+		h.L_length = g.L_length; h.out_length = g.out_length; h.in_length = g.in_length;
+		set_offsets(h);
+
+		wgc.clear();
+		wgc.storage.assign((h.in_offset/8) + no_words(h.in_length), 0);
+		uint64_t* out = wgc.storage.data() + h.out_offset/8;
+		uint64_t* in = wgc.storage.data() + h.in_offset/8;
+		// copy L and the bitvectors, clearing the bits past their length
+		if(g.L_length > 0){ memcpy(reinterpret_cast<uint8_t*>(wgc.storage.data()) + h.L_offset, g.L, g.L_length); }
+		if(g.out_length > 0){ memcpy(out, g.out, no_words(g.out_length)*8); }
+		if(g.in_length > 0){ memcpy(in, g.in, no_words(g.in_length)*8); }
+		if(g.out_length%64 != 0){ out[g.out_length/64] &= (uint64_t(1) << (g.out_length%64)) - 1; }
+		if(g.in_length%64 != 0){ in[g.in_length/64] &= (uint64_t(1) << (g.in_length%64)) - 1; }
+		// compute the header
+		if(!wgc.finalize(h, error)){ wgc.clear(); return false; }
+
+		return true;
+	}
+
+	/* convert the .L/.in/.out files of a Wheeler pseudoforest to a container file */
+	static void convert(std::string basepath, std::string filepath)
+	{
+		wg_container wgc = from_triple(basepath);
+		// write the container
+		FILE* f = std::fopen(filepath.c_str(), "w");
+		if(f == nullptr){ std::cerr << "Error! cannot open " << filepath << ", exiting...\n"; exit(1); }
+		fwrite(wgc.base, 1, wgc.size, f);
+		fclose(f);
+	}
+
+	/* get number of nodes */
+	uint64_t get_no_nodes() const { return header->no_nodes; }
+	/* get number of edges */
+	uint64_t get_L_length() const { return header->L_length; }
+	/* get number of sources */
+	uint64_t get_sources() const { return header->sources; }
+	/* get alphabet size */
+	uint64_t get_sigma() const { return header->sigma; }
+	/* get number of labels smaller than c */
+	uint64_t get_C(uint8_t c) const { return header->C[c]; }
+	/* get outgoing labels */
+	const uint8_t* get_L() const { return reinterpret_cast<const uint8_t*>(base) + header->L_offset; }
+	/* get out-degree bitvector words and length */
+	const uint64_t* get_out() const { return reinterpret_cast<const uint64_t*>(reinterpret_cast<const char*>(base) + header->out_offset); }
+	uint64_t get_out_length() const { return header->out_length; }
+	/* get in-degree bitvector words and length */
+	const uint64_t* get_in() const { return reinterpret_cast<const uint64_t*>(reinterpret_cast<const char*>(base) + header->in_offset); }
+	uint64_t get_in_length() const { return header->in_length; }
+
+private:
+	// container memory: either mapped or owned
+	void* base = nullptr;
+	size_t size = 0;
+	bool mapped = false;
+	std::vector<uint64_t> storage;
+	// container header
+	const wg_header* header = nullptr;
+};
+
+}
+
+#endif /* INTERNAL_WG_CONTAINER_HPP_ */
@@ -1,14 +1,15 @@
 #include <iostream>
 #include <string>
-//#include <ctime>
-//#include <chrono>
+#include <chrono>
+
+#include "internal/partition_refinement.hpp"
 
 // struct storing parameters
 struct Args
 {
 	std::string input;
 	std::string output;
-	//bool verbose = false;
+	bool verbose = false;
 };
 
 // function that prints the instructions for using the tool
@@ -19,10 +20,10 @@ void print_help(char** argv) {
 		<< "Step 1: Compute the deterministic Wheeler pseudoforest of an arbitrary labeled graph." << std::endl << std::endl
 
 	 	<< "	-o, --outpath" << std::endl 
-		<< "		Specify the output file paths." << std::endl 
+		<< "		Specify the output file paths (default: input without .dot + .infsup)." << std::endl 
 
-	 	//<< "	-v, --verbose" << std::endl 
-		//<< "		Activate the verbose mode." << std::endl 
+	 	<< "	-v, --verbose" << std::endl 
+		<< "		Activate the verbose mode." << std::endl 
 
 		<< std::endl;
 }
@@ -37,11 +38,11 @@ void parseArgs(int argc, char** argv, Args& arg) {
 	{
 		std::string param = argv[i];
 
-		//if( param == "-v" or param == "--verbose" )
-		//{
-		//	arg.verbose = true;
-		//}
-		if( param == "-o" or param == "--outpath" )
+		if( param == "-v" or param == "--verbose" )
+		{
+			arg.verbose = true;
+		}
+		else if( param == "-o" or param == "--outpath" )
 		{
 			arg.output = argv[++i];
 		}
@@ -63,21 +64,29 @@ int main(int argc, char** argv)
 	// read input parameters
 	Args arg;
 	parseArgs(argc,argv,arg);
+	// set output path
+	if(arg.output.empty())
+	{
+		arg.output = arg.input;
+		if(arg.output.size() > 4 and arg.output.substr(arg.output.size()-4) == ".dot")
+			arg.output.resize(arg.output.size()-4);
+		arg.output += ".infsup";
+	}
 
 	std::cout << "### Running the preprocessing step on: " << arg.input << std::endl;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	// read input graph
+	pr::labeled_graph G = pr::read_dot(arg.input);
+	if(arg.verbose) std::cout << "no. nodes: " << G.n << " - no. edges: " << G.no_edges() << std::endl;
 	// compute Wheeler pseudoforest
-	std::string command;
-	if(arg.output.empty())
-		command = "python3 external/finite-automata-partition-refinement/partition_refinement.py --prune --compact " + arg.input;
-	else
-		command = "python3 external/finite-automata-partition-refinement/partition_refinement.py -outpath " + arg.output + " --prune --compact " + arg.input;
-	// execute command
-	// if(arg.verbose) std::cout << "Executing: " << command << std::endl;
-	//std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-	std::system(command.c_str());
-	//std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	pr::pseudoforest P = pr::infsup_pseudoforest(G,arg.verbose);
+	if(arg.verbose) std::cout << "Wheeler pseudoforest nodes: " << P.size() << std::endl;
+	// write .L/.in/.out files and the .dot file of the pseudoforest
+	P.write(arg.output);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 
-	//if(arg.verbose) std::cout << "Elapsed time = " << std::chrono::duration_cast<std::chrono::seconds>(end - begin).count() << "[s]" << std::endl;
+	if(arg.verbose) std::cout << "Output written to: " << arg.output << std::endl;
+	if(arg.verbose) std::cout << "Elapsed time = " << float(std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count())/1000 << "[s]" << std::endl;
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -1,19 +1,25 @@
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <cstdlib>
+#include <limits>
 
 #include "internal/WG_string.hpp"
 #include "internal/doubling_ds.hpp"
 #include "internal/interval_stabbing.hpp"
+#include "internal/index_cache.hpp"
 #include "algos/interval_stabbing_algorithm.hpp"
 #include "algos/doubling_algorithm.hpp"
 
+
 // struct storing parameters
 struct Args
 {
 	std::string input;
 	int algo = -1;
-	bool check = false, print = false, verb = false;
+	bool check = false, print = false, verb = false, container = false, cache = false, compress = false, mmap = false, semi_external = false, compact = false;
+	unsigned threads = 1;
+	bool batched = false, sorted = false, out_map = false, sweep = false;
 };
 
 // function that prints the instructions for using the tool
@@ -35,6 +41,39 @@ void print_help(char** argv) {
 	 	//<< "	-p, --preprocessing" << std::endl 
 		//<< "		Perform preprocessing step computing the Wheeler pseudoforest of an arbitrary labeled graph." << std::endl 
 
+	 	<< "	-w, --wg-container" << std::endl 
+		<< "		Read the input from the bit-packed container [input].wg (see triple-to-wg)." << std::endl 
+
+	 	<< "	-x, --index-cache" << std::endl 
+		<< "		Load the FM-index and the packed BWT from [input].idx, building it on the first run (-b and -s only)." << std::endl 
+
+	 	<< "	-z, --compressed-LCP" << std::endl 
+		<< "		Write the LCP vector in the block-wise bit-packed format [input].cLCP (see internal/packed_LCP.hpp)." << std::endl 
+
+	 	<< "	-m, --mmap-LCP" << std::endl 
+		<< "		Store the LCP vector in the memory-mapped output file [input].LCP during the construction." << std::endl 
+
+	 	<< "	-k, --compact-LCP" << std::endl 
+		<< "		Store the LCP vector bit-packed with the minimum width for the input size during the construction." << std::endl 
+
+	 	<< "	-e, --semi-external" << std::endl 
+		<< "		Run -b keeping only a bitvector of filled entries in RAM and spilling the LCP values to disk." << std::endl 
+
+	 	<< "	-t, --threads N" << std::endl 
+		<< "		Run -b and -s with N threads processing each LCP level in parallel (not with -k and -e; -f, -r and -g are then ignored, -s always sorts the levels)." << std::endl 
+
+	 	<< "	-f, --batched-forward" << std::endl 
+		<< "		Run -b computing the forward steps of each LCP level in batches traversing the wavelet tree breadth-first." << std::endl 
+
+	 	<< "	-r, --sorted-levels" << std::endl 
+		<< "		Run -b and -s radix-sorting each queue level by left endpoint, so that the index is accessed left to right." << std::endl 
+
+	 	<< "	-g, --sweep-dense" << std::endl 
+		<< "		Run -b and -s computing the forward steps of the dense levels with a linear scan of a plain copy of the labels." << std::endl 
+
+	 	<< "	-o, --out-map" << std::endl 
+		<< "		Run -b and -s mapping the nodes to their outgoing labels with an explicit array instead of rank/select on the out bitvector." << std::endl 
+
 	 	<< "	-v, --verbose" << std::endl 
 		<< "		Activate the verbose mode." << std::endl 
 
@@ -72,6 +111,55 @@ void parseArgs(int argc, char** argv, Args& arg) {
 		//{
 		//	arg.prep = true;
 		//}
+		else if( param == "-w" or param == "--wg-container" )
+		{
+			arg.container = true;
+		}
+		else if( param == "-x" or param == "--index-cache" )
+		{
+			arg.cache = true;
+		}
+		else if( param == "-z" or param == "--compressed-LCP" )
+		{
+			arg.compress = true;
+		}
+		else if( param == "-m" or param == "--mmap-LCP" )
+		{
+			arg.mmap = true;
+		}
+		else if( param == "-k" or param == "--compact-LCP" )
+		{
+			arg.compact = true;
+		}
+		else if( param == "-e" or param == "--semi-external" )
+		{
+			arg.semi_external = true;
+		}
+		else if( (param == "-t" or param == "--threads") and i+1 < argc-1 )
+		{
+			// the number of threads must be a positive integer
+			char* end = nullptr; const char* val = argv[++i];
+			unsigned long t = (*val >= '0' and *val <= '9') ? std::strtoul(val, &end, 10) : 0;
+			if( t == 0 or *end != '\0' or t > std::numeric_limits<unsigned>::max() )
+				{ std::cerr << "Unknown option. Use -h for help." << std::endl; exit(-1); }
+			arg.threads = t;
+		}
+		else if( param == "-f" or param == "--batched-forward" )
+		{
+			arg.batched = true;
+		}
+		else if( param == "-r" or param == "--sorted-levels" )
+		{
+			arg.sorted = true;
+		}
+		else if( param == "-g" or param == "--sweep-dense" )
+		{
+			arg.sweep = true;
+		}
+		else if( param == "-o" or param == "--out-map" )
+		{
+			arg.out_map = true;
+		}
 		else if( param == "-v" or param == "--verbose" )
 		{
 			arg.verb = true;
@@ -101,50 +189,147 @@ void parseArgs(int argc, char** argv, Args& arg) {
 		std::cerr << "Select a LCP construction algorithm! exiting..." << std::endl;
 		exit(1);
 	}
+	if( arg.threads > 1 and (arg.algo == 1 or arg.compact or arg.semi_external) )
+		std::cerr << "Warning! -t is only supported by -b and -s without -k and -e, running with 1 thread." << std::endl;
+	else if( arg.threads > 1 and arg.algo != 1 and (arg.batched or arg.sorted or arg.sweep) )
+		std::cerr << "Warning! -f, -r and -g are not supported by -b and -s with -t, ignoring them." << std::endl;
 }
 
-int main(int argc, char** argv)
+// function running the prefix doubling algorithm on the input container
+template<class ds_t>
+void run_prefix_doubling(wg::wg_container* wgc, Args& arg)
 {
-	// read input parameters
-	Args arg;
-	parseArgs(argc,argv,arg);
+	// compute prefix doubling data structure
+	ds_t* ds = new ds_t(*wgc,arg.input);
+	delete wgc;
+	// compute LCP using the prefix doubling algorithm
+	prefix_doubling_LCP(*ds,arg.check,arg.print,arg.verb,arg.compress);
+	delete ds;
+}
 
-	/*if(arg.prep)
-	{
-		std::cout << "Running the preprocessing step on: " << arg.input << std::endl;
-		// compute infsup automaton
-		std::string command = "python3 external/finite-automata-partition-refinement/partition_refinement.py --prune --compact " + arg.input;
-		std::cout << "Executing: " << command << std::endl;
-		std::system(command.c_str());
-	}*/
+// function running the selected algorithm with index width uint_t and
+// out bitvector out_bv_t
+template<class uint_t, class out_bv_t>
+void run(Args& arg)
+{
+	typedef wg::wg_fm_index<wg::huff_wt, out_bv_t, uint_t> fm_index_t;
+	typedef wg::interval_stabbing<fm_index_t> stab_ds_t;
+	typedef ds::doubling_ds<ds::static_rmq<uint_t>, wg::bit_vector> doubling_ds_t;
+	typedef ds::doubling_ds<ds::static_rmq<uint_t, wg::mmap_vector<uint_t>>, wg::bit_vector> doubling_mmap_ds_t;
+	typedef ds::doubling_ds<ds::static_rmq<uint_t, wg::compact_LCP_vector<uint_t>>, wg::bit_vector> doubling_compact_ds_t;
 
-	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	// load the FM-index and the packed BWT from the index cache, building it if needed;
+	// the interval stabbing algorithm does not use the wavelet tree
+	wg::index_cache<fm_index_t>* cache = (arg.cache and arg.algo != 1) ? 
+	                  new wg::index_cache<fm_index_t>(arg.input,arg.container,arg.verb,arg.algo == 0) : nullptr;
+	// otherwise map the bit-packed container or read the input files once, all
+	// the index structures are then constructed from the same container
+	wg::wg_container* wgc = nullptr;
+	if(cache == nullptr)
+		wgc = arg.container ? new wg::wg_container(arg.input+".wg")
+		                    : new wg::wg_container(wg::wg_container::from_triple(arg.input));
 	
 	if(arg.algo == 0)
 	{
 		if(arg.verb) std::cout << "Running generalization of Beller et al. algorithm" << std::endl;
 		// construct fm-index for pruned Wheeler graph
-		wg::wg_fm_index<wg::huff_wt, wg::bit_vector> wg(arg.input);
+		fm_index_t* wg = cache ? &cache->get_fm_index() : new fm_index_t(*wgc,arg.input);
+		delete wgc;
 		// compute LCP using the generalization of the algorithm of Beller et al.
-		compute_LCP_Beller_gen(wg,arg.check,arg.print,arg.verb);
+		if(arg.semi_external)
+			compute_LCP_Beller_gen_semi_external(*wg,arg.check,arg.print,arg.verb,arg.compress,arg.sorted);
+		else if(arg.mmap)
+			compute_LCP_Beller_gen<fm_index_t,wg::mmap_vector<uint_t>>(*wg,arg.check,arg.print,arg.verb,arg.compress,arg.threads,arg.batched,arg.sorted,arg.sweep);
+		else if(arg.compact)
+			compute_LCP_Beller_gen<fm_index_t,wg::compact_LCP_vector<uint_t>>(*wg,arg.check,arg.print,arg.verb,arg.compress,1,arg.batched,arg.sorted,arg.sweep);
+		else
+			compute_LCP_Beller_gen(*wg,arg.check,arg.print,arg.verb,arg.compress,arg.threads,arg.batched,arg.sorted,arg.sweep);
+		if(cache == nullptr) delete wg;
 	}
 	else if(arg.algo == 1)
 	{
 		if(arg.verb) std::cout << "Running generalization of Manber-Myers doubling algorithm" << std::endl;
-		// compute prefix doubling data structure
-		ds::doubling_ds<ds::static_rmq, wg::bit_vector> ds(arg.input);
-		// compute LCP using the prefix doubling algorithm
-		prefix_doubling_LCP(ds,arg.check,arg.print,arg.verb);
+		if(arg.mmap)
+			run_prefix_doubling<doubling_mmap_ds_t>(wgc,arg);
+		else if(arg.compact)
+			run_prefix_doubling<doubling_compact_ds_t>(wgc,arg);
+		else
+			run_prefix_doubling<doubling_ds_t>(wgc,arg);
 	}
 	else if(arg.algo == 2)
 	{
 		if(arg.verb) std::cout << "Running interval stabbing algorithm" << std::endl;
-		// construct fm-index for pruned Wheeler graph.
-		wg::wg_fm_index<wg::huff_wt, wg::bit_vector> wg(arg.input);
+		// construct fm-index for pruned Wheeler graph, the forward steps are
+		// computed by the interval stabbing data structure without the wavelet tree
+		fm_index_t* wg = cache ? &cache->get_fm_index() : new fm_index_t(*wgc,arg.input,false);
 		// compute interval stabbing data structure
-		wg::interval_stabbing<wg::wg_fm_index<wg::huff_wt, wg::bit_vector>> sds(arg.input+".L",&wg);
+		stab_ds_t* sds = cache ? &cache->get_interval_stabbing() : new stab_ds_t(*wgc,wg);
+		delete wgc;
 		// compute LCP using interval stabbing data structure
-		compute_LCP_interval_stabbing(sds,arg.check,arg.print,arg.verb);
+		if(arg.mmap)
+			compute_LCP_interval_stabbing<stab_ds_t,wg::mmap_vector<uint_t>>(*sds,arg.check,arg.print,arg.verb,arg.compress,arg.sorted,arg.sweep,arg.threads);
+		else if(arg.compact)
+			compute_LCP_interval_stabbing<stab_ds_t,wg::compact_LCP_vector<uint_t>>(*sds,arg.check,arg.print,arg.verb,arg.compress,arg.sorted,arg.sweep,arg.threads);
+		else
+			compute_LCP_interval_stabbing(*sds,arg.check,arg.print,arg.verb,arg.compress,arg.sorted,arg.sweep,arg.threads);
+		if(cache == nullptr){ delete sds; delete wg; }
+	}
+	delete cache;
+}
+
+// function computing the number of nodes of the input without reading it
+uint64_t get_no_nodes(Args& arg)
+{
+	if(arg.container)
+		return wg::wg_container(arg.input+".wg").get_no_nodes();
+	// all nodes except the sources have one incoming edge: |in| = n + |L|
+	struct stat st_in, st_L;
+	if(stat((arg.input+".in").c_str(), &st_in) != 0 or stat((arg.input+".L").c_str(), &st_L) != 0)
+	{
+		std::cerr << "Error! cannot open the input files, exiting..." << std::endl;
+		exit(1);
+	}
+	return st_in.st_size - st_L.st_size;
+}
+
+// function selecting the out bitvector of the FM-index
+template<class uint_t>
+void run_width(Args& arg)
+{
+	if(arg.out_map and arg.algo != 1)
+		run<uint_t, wg::select_rank_vector>(arg);
+	else
+		run<uint_t, wg::bit_vector>(arg);
+}
+
+int main(int argc, char** argv)
+{
+	// read input parameters
+	Args arg;
+	parseArgs(argc,argv,arg);
+
+	/*if(arg.prep)
+	{
+		std::cout << "Running the preprocessing step on: " << arg.input << std::endl;
+		// compute infsup automaton
+		std::string command = "python3 external/finite-automata-partition-refinement/partition_refinement.py --prune --compact " + arg.input;
+		std::cout << "Executing: " << command << std::endl;
+		std::system(command.c_str());
+	}*/
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	// select the index width from the number of nodes, INF and EMPTY
+	// must not be valid positions or LCP values
+	uint64_t n = get_no_nodes(arg);
+	if(M64 or n >= UINT32_MAX - 2)
+	{
+		if(arg.verb) std::cout << "Using 64-bit indexes for " << n << " nodes" << std::endl;
+		run_width<uint64_t>(arg);
+	}
+	else
+	{
+		if(arg.verb) std::cout << "Using 32-bit indexes for " << n << " nodes" << std::endl;
+		run_width<uint32_t>(arg);
 	}
 
 	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
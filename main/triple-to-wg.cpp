@@ -0,0 +1,24 @@
+#include <iostream>
+#include <string>
+
+#include "internal/wg_container.hpp"
+
+// function that prints the instructions for using the tool
+void print_help(char** argv) { 
+	std::cout << std::endl <<
+		"Usage: " << argv[0] << " [input]" << std::endl 
+
+		<< "Convert the .L/.in/.out files of a Wheeler pseudoforest to the bit-packed container [input].wg." << std::endl 
+		<< std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc != 2 or std::string(argv[1]) == "-h" or std::string(argv[1]) == "--help"){ print_help(argv); exit(1); }
+
+	std::string input = argv[1];
+	std::cout << "### Converting " << input << " to " << input << ".wg" << std::endl;
+	wg::wg_container::convert(input, input+".wg");
+
+	return 0;
+}